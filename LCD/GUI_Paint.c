@@ -43,66 +43,73 @@
 
 PAINT Paint;
 
+static UBYTE Paint_ColorIndex(PAINT *ctx, UWORD Color);
+
 /******************************************************************************
 function: Create Image
 parameter:
+    ctx    : Paint context
     image   :   Pointer to the image cache
     width   :   The width of the picture
     Height  :   The height of the picture
     Color   :   Whether the picture is inverted
+info:
+    Resets the whole context, select the palette afterwards.
 ******************************************************************************/
-void Paint_NewImage(UWORD *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color, UWORD Depth)
+void Paint_NewImage_ctx(PAINT *ctx, UWORD *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color, UWORD Depth)
 {
-    Paint.Image = NULL;
-    Paint.Image = image;
+    memset(ctx, 0, sizeof(PAINT));
+    ctx->Image = image;
 
-    Paint.WidthMemory = Width;
-    Paint.HeightMemory = Height;
-    Paint.Color = Color;    
-    Paint.WidthByte = Width;
-    Paint.HeightByte = Height;    
-    Paint.Depth = Depth;    
-//    printf("WidthByte = %d, HeightByte = %d\r\n", Paint.WidthByte, Paint.HeightByte);
+    ctx->WidthMemory = Width;
+    ctx->HeightMemory = Height;
+    ctx->Color = Color;    
+    ctx->WidthByte = Width;
+    ctx->HeightByte = Height;    
+    ctx->Depth = Depth;    
+//    printf("WidthByte = %d, HeightByte = %d\r\n", ctx->WidthByte, ctx->HeightByte);
 //    printf(" EPD_WIDTH / 8 = %d\r\n",  122 / 8);
    
-    Paint.Rotate = Rotate;
-    Paint.Mirror = MIRROR_NONE;
+    ctx->Rotate = Rotate;
+    ctx->Mirror = MIRROR_NONE;
     
     if(Rotate == ROTATE_0 || Rotate == ROTATE_180) {
-        Paint.Width = Width;
-        Paint.Height = Height;
+        ctx->Width = Width;
+        ctx->Height = Height;
     } else {
-        Paint.Width = Height;
-        Paint.Height = Width;
+        ctx->Width = Height;
+        ctx->Height = Width;
     }
 }
 
 /******************************************************************************
 function: Select Image
 parameter:
+    ctx    : Paint context
     image : Pointer to the image cache
 ******************************************************************************/
-void Paint_SelectImage(UWORD *image)
+void Paint_SelectImage_ctx(PAINT *ctx, UWORD *image)
 {
-    Paint.Image = image;
+    ctx->Image = image;
 }
 
 /******************************************************************************
 function: Select Image Rotate
 parameter:
+    ctx    : Paint context
     Rotate : 0,90,180,270
 ******************************************************************************/
-void Paint_SetRotate(UWORD Rotate)
+void Paint_SetRotate_ctx(PAINT *ctx, UWORD Rotate)
 {
     if(Rotate == ROTATE_0 || Rotate == ROTATE_90 || Rotate == ROTATE_180 || Rotate == ROTATE_270) {
         DEBUG("Set image Rotate %d\r\n", Rotate);
-        Paint.Rotate = Rotate;
+        ctx->Rotate = Rotate;
     if(Rotate == ROTATE_0 || Rotate == ROTATE_180) {
-        Paint.Width = Paint.WidthMemory;
-        Paint.Height = Paint.HeightMemory;
+        ctx->Width = ctx->WidthMemory;
+        ctx->Height = ctx->HeightMemory;
     } else {
-        Paint.Width = Paint.HeightMemory;
-        Paint.Height = Paint.WidthMemory;
+        ctx->Width = ctx->HeightMemory;
+        ctx->Height = ctx->WidthMemory;
     }
     } else {
         DEBUG("rotate = 0, 90, 180, 270\r\n");
@@ -112,14 +119,15 @@ void Paint_SetRotate(UWORD Rotate)
 /******************************************************************************
 function:	Select Image mirror
 parameter:
+    ctx    : Paint context
     mirror   :Not mirror,Horizontal mirror,Vertical mirror,Origin mirror
 ******************************************************************************/
-void Paint_SetMirroring(UBYTE mirror)
+void Paint_SetMirroring_ctx(PAINT *ctx, UBYTE mirror)
 {
     if(mirror == MIRROR_NONE || mirror == MIRROR_HORIZONTAL || 
         mirror == MIRROR_VERTICAL || mirror == MIRROR_ORIGIN) {
         DEBUG("mirror image x:%s, y:%s\r\n",(mirror & 0x01)? "mirror":"none", ((mirror >> 1) & 0x01)? "mirror":"none");
-        Paint.Mirror = mirror;
+        ctx->Mirror = mirror;
     } else {
         DEBUG("mirror should be MIRROR_NONE, MIRROR_HORIZONTAL, \
         MIRROR_VERTICAL or MIRROR_ORIGIN\r\n");
@@ -129,87 +137,99 @@ void Paint_SetMirroring(UBYTE mirror)
 /******************************************************************************
 function: Draw Pixels
 parameter:
+    ctx    : Paint context
     Xpoint : At point X
     Ypoint : At point Y
     Color  : Painted colors
 ******************************************************************************/
-void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
+void Paint_SetPixel_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, UWORD Color)
 {
-    if(Xpoint > Paint.Width || Ypoint > Paint.Height){
+    if(Xpoint > ctx->Width || Ypoint > ctx->Height){
        // DEBUG("Exceeding display boundaries\r\n");
         return;
     }      
     UWORD X, Y;
 
-    switch(Paint.Rotate) {
+    switch(ctx->Rotate) {
     case 0:
         X = Xpoint;
         Y = Ypoint;  
         break;
     case 90:
-        X = Paint.WidthMemory - Ypoint - 1;
+        X = ctx->WidthMemory - Ypoint - 1;
         Y = Xpoint;
         break;
     case 180:
-        X = Paint.WidthMemory - Xpoint - 1;
-        Y = Paint.HeightMemory - Ypoint - 1;
+        X = ctx->WidthMemory - Xpoint - 1;
+        Y = ctx->HeightMemory - Ypoint - 1;
         break;
     case 270:
         X = Ypoint;
-        Y = Paint.HeightMemory - Xpoint - 1;
+        Y = ctx->HeightMemory - Xpoint - 1;
         break;
     default:
         return;
     }
     
-    switch(Paint.Mirror) {
+    switch(ctx->Mirror) {
     case MIRROR_NONE:
         break;
     case MIRROR_HORIZONTAL:
-        X = Paint.WidthMemory - X - 1;
+        X = ctx->WidthMemory - X - 1;
         break;
     case MIRROR_VERTICAL:
-        Y = Paint.HeightMemory - Y - 1;
+        Y = ctx->HeightMemory - Y - 1;
         break;
     case MIRROR_ORIGIN:
-        X = Paint.WidthMemory - X - 1;
-        Y = Paint.HeightMemory - Y - 1;
+        X = ctx->WidthMemory - X - 1;
+        Y = ctx->HeightMemory - Y - 1;
         break;
     default:
         return;
     }
 
-    if(X > Paint.WidthMemory || Y > Paint.HeightMemory){
+    if(X > ctx->WidthMemory || Y > ctx->HeightMemory){
         DEBUG("Exceeding display boundaries\r\n");
         return;
     }
     
     
-    if(Paint.Depth == 1){
-        UDOUBLE Addr = X / 8 + Y * Paint.WidthByte;
-        UBYTE Rdata = Paint.Image[Addr];
+    if(ctx->Depth == 1){
+        UDOUBLE Addr = X / 8 + Y * ctx->WidthByte;
+        UBYTE Rdata = ctx->Image[Addr];
         if(Color == BLACK)
-            Paint.Image[Addr] = Rdata & ~(0x80 >> (X % 8));
+            ctx->Image[Addr] = Rdata & ~(0x80 >> (X % 8));
         else
-            Paint.Image[Addr] = Rdata | (0x80 >> (X % 8));
+            ctx->Image[Addr] = Rdata | (0x80 >> (X % 8));
+    } else if(ctx->Depth == 8){
+        if(ctx->Palette == NULL)
+            return;
+        UDOUBLE Addr = X  + Y * ctx->WidthByte;
+        ((UBYTE *)ctx->Image)[Addr] = Paint_ColorIndex(ctx, Color);
     } else {
         Color = ((Color<<8)&0xff00)|(Color>>8);
-        UDOUBLE Addr = X  + Y * Paint.WidthByte;
-        Paint.Image[Addr] = Color;
+        UDOUBLE Addr = X  + Y * ctx->WidthByte;
+        ctx->Image[Addr] = Color;
     }
 }
 
 /******************************************************************************
 function: Clear the color of the picture
 parameter:
+    ctx    : Paint context
     Color : Painted colors
 ******************************************************************************/
-void Paint_Clear(UWORD Color)
+void Paint_Clear_ctx(PAINT *ctx, UWORD Color)
 {
-    for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
-        for (UWORD X = 0; X < Paint.WidthByte; X++ ) {//8 pixel =  1 byte
-            UDOUBLE Addr = X + Y*Paint.WidthByte;
-            Paint.Image[Addr] = Color;
+    if(ctx->Depth == 8) {
+        if(ctx->Palette != NULL)
+            memset(ctx->Image, Paint_ColorIndex(ctx, Color), (size_t)ctx->WidthByte * ctx->HeightByte);
+        return;
+    }
+    for (UWORD Y = 0; Y < ctx->HeightByte; Y++) {
+        for (UWORD X = 0; X < ctx->WidthByte; X++ ) {//8 pixel =  1 byte
+            UDOUBLE Addr = X + Y*ctx->WidthByte;
+            ctx->Image[Addr] = Color;
         }
     }
 }
@@ -217,35 +237,482 @@ void Paint_Clear(UWORD Color)
 /******************************************************************************
 function: Clear the color of a window
 parameter:
+    ctx    : Paint context
     Xstart : x starting point
     Ystart : Y starting point
     Xend   : x end point
     Yend   : y end point
     Color  : Painted colors
 ******************************************************************************/
-void Paint_ClearWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+void Paint_ClearWindow_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
 {
     UWORD X, Y;
     for (Y = Ystart; Y < Yend; Y++) {
         for (X = Xstart; X < Xend; X++) {//8 pixel =  1 byte
-            Paint_SetPixel(X, Y, Color);
+            Paint_SetPixel_ctx(ctx, X, Y, Color);
+        }
+    }
+}
+
+/******************************************************************************
+function: Select the palette used by an 8 bit (indexed colour) image
+parameter:
+    ctx    : Paint context
+    Palette : Palette initialised with Paint_PaletteInit
+******************************************************************************/
+void Paint_SetPalette_ctx(PAINT *ctx, PAINT_PALETTE *Palette)
+{
+    ctx->Palette = Palette;
+    memset(ctx->Cache, 0, sizeof(ctx->Cache));
+}
+
+/******************************************************************************
+function: Empty a palette
+parameter:
+    Palette : Palette to initialise
+******************************************************************************/
+void Paint_PaletteInit(PAINT_PALETTE *Palette)
+{
+    memset(Palette, 0, sizeof(PAINT_PALETTE));
+}
+
+//Hash slot layout: bit 31 used, bits 16-23 index, bits 0-15 RGB565 colour
+#define PALETTE_SLOT(Index, Color)  (0x80000000 | ((UDOUBLE)(Index) << 16) | (Color))
+
+static UDOUBLE Paint_PaletteHash(UWORD Color)
+{
+    return ((UDOUBLE)Color * 2654435761u) >> 20 & (PALETTE_HASH_SIZE - 1);
+}
+
+static void Paint_PaletteRemember(PAINT_PALETTE *Palette, UWORD Color, UBYTE Index)
+{
+    UDOUBLE h = Paint_PaletteHash(Color);
+    UDOUBLE n;
+
+    for(n = 0; n < PALETTE_HASH_SIZE; n++) {
+        if(Palette->Hash[h] == 0) {
+            Palette->Hash[h] = PALETTE_SLOT(Index, Color);
+            return;
+        }
+        h = (h + 1) & (PALETTE_HASH_SIZE - 1);
+    }
+    //table full, colour will be searched for again next time
+}
+
+//Colour distance in RGB565 space, green weighted like the eye
+static UDOUBLE Paint_ColorDistance(UWORD a, UWORD b)
+{
+    int dr = (int)(a >> 11) - (int)(b >> 11);
+    int dg = (int)((a >> 5) & 0x3f) - (int)((b >> 5) & 0x3f);
+    int db = (int)(a & 0x1f) - (int)(b & 0x1f);
+
+    return 3*4*dr*dr + 4*dg*dg + 2*4*db*db;
+}
+
+static UBYTE Paint_PaletteNearest(const PAINT_PALETTE *Palette, UWORD Color)
+{
+    UDOUBLE Best = 0xffffffff, d;
+    UWORD i, Entry;
+    UBYTE Index = 0;
+
+    for(i = 0; i < Palette->Count; i++) {
+        Entry = (Palette->Color[i] << 8) | (Palette->Color[i] >> 8);
+        d = Paint_ColorDistance(Entry, Color);
+        if(d < Best) {
+            Best = d;
+            Index = i;
+            if(d == 0)
+                break;
+        }
+    }
+    return Index;
+}
+
+/******************************************************************************
+function: Add a colour to a palette
+parameter:
+    Palette : Palette to add to
+    Color   : RGB565 colour
+info:
+    Returns the index of the colour. If the colour is already present its
+    index is returned; if the palette is full the nearest entry is used.
+******************************************************************************/
+UBYTE Paint_PaletteAdd(PAINT_PALETTE *Palette, UWORD Color)
+{
+    UWORD Swapped = ((Color<<8)&0xff00)|(Color>>8);
+    UDOUBLE h = Paint_PaletteHash(Color);
+    UDOUBLE n;
+    UBYTE Index;
+
+    for(n = 0; n < PALETTE_HASH_SIZE && Palette->Hash[h] != 0; n++) {
+        if((Palette->Hash[h] & 0xffff) == Color)
+            break;
+        h = (h + 1) & (PALETTE_HASH_SIZE - 1);
+    }
+
+    if(n < PALETTE_HASH_SIZE && Palette->Hash[h] != 0) {
+        Index = (Palette->Hash[h] >> 16) & 0xff;
+        if(Palette->Color[Index] == Swapped || Palette->Count >= PALETTE_SIZE)
+            return Index;
+        //only a nearest match so far, give the colour its own entry
+        Index = Palette->Count++;
+        Palette->Color[Index] = Swapped;
+        Palette->Hash[h] = PALETTE_SLOT(Index, Color);
+        return Index;
+    }
+
+    if(Palette->Count >= PALETTE_SIZE)
+        return Paint_PaletteIndex(Palette, Color);
+
+    Index = Palette->Count++;
+    Palette->Color[Index] = Swapped;
+    Paint_PaletteRemember(Palette, Color, Index);
+    return Index;
+}
+
+//Hash probe, returns the slot holding Color or NULL
+static const UDOUBLE *Paint_PaletteProbe(const PAINT_PALETTE *Palette, UWORD Color)
+{
+    UDOUBLE h = Paint_PaletteHash(Color);
+    UDOUBLE n;
+
+    for(n = 0; n < PALETTE_HASH_SIZE && Palette->Hash[h] != 0; n++) {
+        if((Palette->Hash[h] & 0xffff) == Color)
+            return &Palette->Hash[h];
+        h = (h + 1) & (PALETTE_HASH_SIZE - 1);
+    }
+    return NULL;
+}
+
+/******************************************************************************
+function: Find the palette index used to draw a colour, remembering it
+parameter:
+    Palette : Palette to search
+    Color   : RGB565 colour
+info:
+    Colours not in the palette are matched to the nearest entry and the
+    match is added to the hash. This changes the palette, so use it while
+    setting up; drawing uses Paint_PaletteLookup.
+******************************************************************************/
+UBYTE Paint_PaletteIndex(PAINT_PALETTE *Palette, UWORD Color)
+{
+    const UDOUBLE *Slot = Paint_PaletteProbe(Palette, Color);
+    UBYTE Index;
+
+    if(Slot != NULL)
+        return (*Slot >> 16) & 0xff;
+
+    Index = Paint_PaletteNearest(Palette, Color);
+    Paint_PaletteRemember(Palette, Color, Index);
+    return Index;
+}
+
+/******************************************************************************
+function: Find the palette index used to draw a colour
+parameter:
+    Palette : Palette to search
+    Color   : RGB565 colour
+info:
+    Read only, so any number of contexts can share one palette.
+******************************************************************************/
+UBYTE Paint_PaletteLookup(const PAINT_PALETTE *Palette, UWORD Color)
+{
+    const UDOUBLE *Slot = Paint_PaletteProbe(Palette, Color);
+
+    if(Slot != NULL)
+        return (*Slot >> 16) & 0xff;
+    return Paint_PaletteNearest(Palette, Color);
+}
+
+//Palette index through the small per context cache
+static UBYTE Paint_ColorIndex(PAINT *ctx, UWORD Color)
+{
+    UDOUBLE *Slot = &ctx->Cache[(Color ^ (Color >> 7)) & (PAINT_CACHE_SIZE - 1)];
+    UBYTE Index;
+
+    if((*Slot & 0x80000000) && (*Slot & 0xffff) == Color)
+        return (*Slot >> 16) & 0xff;
+    Index = Paint_PaletteLookup(ctx->Palette, Color);
+    *Slot = PALETTE_SLOT(Index, Color);
+    return Index;
+}
+
+/******************************************************************************
+function: Change the displayed colour of a palette entry
+parameter:
+    Palette : Palette to change
+    Index   : Entry to change
+    Color   : New RGB565 colour
+info:
+    Drawing code keeps using the original colour to select the entry, only
+    what is sent to the panel changes. Re-flushing the image is enough to
+    animate (e.g. flash) everything drawn with that entry.
+******************************************************************************/
+void Paint_PaletteSetEntry(PAINT_PALETTE *Palette, UBYTE Index, UWORD Color)
+{
+    Palette->Color[Index] = ((Color<<8)&0xff00)|(Color>>8);
+}
+
+static int Paint_PaletteCompare(const void *a, const void *b)
+{
+    UDOUBLE x = *(const UDOUBLE *)a >> 16, y = *(const UDOUBLE *)b >> 16;
+    return (x < y) - (x > y);   //most used first
+}
+
+/******************************************************************************
+function: Fill the rest of a palette with the most used colours of images
+parameter:
+    Palette : Palette, colours already added are kept
+    image   : Array of 16 bit images in panel byte order
+    Count   : Number of images
+    Pixels  : Number of pixels in each image
+info:
+    Popularity quantisation. The screens are mostly flat fills, so the most
+    used colours cover nearly every pixel; the rest map to the nearest entry.
+    Only meant to be run once at start up.
+******************************************************************************/
+void Paint_PaletteBuild(PAINT_PALETTE *Palette, const unsigned char *image[], UBYTE Count, UDOUBLE Pixels)
+{
+    UDOUBLE *Histogram, *Used;
+    UDOUBLE i, n = 0;
+    UBYTE k;
+
+    Histogram = (UDOUBLE *)calloc(65536, sizeof(UDOUBLE));
+    if(Histogram == NULL)
+        return;
+
+    for(k = 0; k < Count; k++) {
+        for(i = 0; i < Pixels; i++) {
+            UWORD Color = image[k][2*i] << 8 | image[k][2*i + 1];
+            if(Histogram[Color] < 0xffff)
+                Histogram[Color]++;
+        }
+    }
+
+    //pack count and colour together, then sort by count
+    Used = Histogram;
+    for(i = 0; i < 65536; i++) {
+        if(Histogram[i] != 0)
+            Used[n++] = Histogram[i] << 16 | i;
+    }
+    qsort(Used, n, sizeof(UDOUBLE), Paint_PaletteCompare);
+
+    for(i = 0; i < n && Palette->Count < PALETTE_SIZE; i++)
+        Paint_PaletteAdd(Palette, Used[i] & 0xffff);
+
+    free(Histogram);
+}
+
+/******************************************************************************
+function: Copy a full screen 16 bit image into the selected image
+parameter:
+    ctx    : Paint context
+    image : Image in panel byte order, WidthMemory x HeightMemory pixels
+info:
+    The image is copied in memory order, rotation is not applied.
+    8 bit images are converted through the selected palette.
+******************************************************************************/
+void Paint_ImportImage_ctx(PAINT *ctx, const unsigned char *image)
+{
+    UDOUBLE i, Pixels = (UDOUBLE)ctx->WidthMemory * ctx->HeightMemory;
+
+    if(ctx->Depth == 8) {
+        UBYTE *Dest = (UBYTE *)ctx->Image;
+        if(ctx->Palette == NULL)
+            return;
+        for(i = 0; i < Pixels; i++)
+            Dest[i] = Paint_PaletteIndex(ctx->Palette, image[2*i] << 8 | image[2*i + 1]);
+    } else {
+        memcpy(ctx->Image, image, Pixels * 2);
+    }
+}
+
+/******************************************************************************
+function: Grow a rectangle to cover another one
+parameter:
+    Rect : Rectangle to grow, may be empty
+    Add  : Rectangle to add, may be empty
+******************************************************************************/
+void Paint_RectUnion(PAINT_RECT *Rect, PAINT_RECT Add)
+{
+    if(Add.Xstart >= Add.Xend || Add.Ystart >= Add.Yend)
+        return;
+    if(Rect->Xstart >= Rect->Xend || Rect->Ystart >= Rect->Yend) {
+        *Rect = Add;
+        return;
+    }
+    if(Add.Xstart < Rect->Xstart) Rect->Xstart = Add.Xstart;
+    if(Add.Ystart < Rect->Ystart) Rect->Ystart = Add.Ystart;
+    if(Add.Xend > Rect->Xend) Rect->Xend = Add.Xend;
+    if(Add.Yend > Rect->Yend) Rect->Yend = Add.Yend;
+}
+
+/******************************************************************************
+function: Convert a rectangle in drawing coordinates to image memory
+            coordinates, applying rotation and mirroring like Paint_SetPixel
+parameter:
+    ctx    : Paint context
+    Rect : Rectangle in drawing coordinates
+info:
+    The result is clipped to the image and can be sent to the LCD as a window.
+******************************************************************************/
+PAINT_RECT Paint_RectMemory_ctx(PAINT *ctx, PAINT_RECT Rect)
+{
+    PAINT_RECT Mem;
+    UWORD W = ctx->WidthMemory, H = ctx->HeightMemory;
+
+    if(Rect.Xend > ctx->Width) Rect.Xend = ctx->Width;
+    if(Rect.Yend > ctx->Height) Rect.Yend = ctx->Height;
+    if(Rect.Xstart >= Rect.Xend || Rect.Ystart >= Rect.Yend) {
+        Mem.Xstart = Mem.Ystart = Mem.Xend = Mem.Yend = 0;
+        return Mem;
+    }
+
+    switch(ctx->Rotate) {
+    case 90:
+        Mem.Xstart = W - Rect.Yend;
+        Mem.Xend = W - Rect.Ystart;
+        Mem.Ystart = Rect.Xstart;
+        Mem.Yend = Rect.Xend;
+        break;
+    case 180:
+        Mem.Xstart = W - Rect.Xend;
+        Mem.Xend = W - Rect.Xstart;
+        Mem.Ystart = H - Rect.Yend;
+        Mem.Yend = H - Rect.Ystart;
+        break;
+    case 270:
+        Mem.Xstart = Rect.Ystart;
+        Mem.Xend = Rect.Yend;
+        Mem.Ystart = H - Rect.Xend;
+        Mem.Yend = H - Rect.Xstart;
+        break;
+    default:
+        Mem = Rect;
+    }
+
+    if(ctx->Mirror & MIRROR_HORIZONTAL) {
+        UWORD X = Mem.Xstart;
+        Mem.Xstart = W - Mem.Xend;
+        Mem.Xend = W - X;
+    }
+    if(ctx->Mirror & MIRROR_VERTICAL) {
+        UWORD Y = Mem.Ystart;
+        Mem.Ystart = H - Mem.Yend;
+        Mem.Yend = H - Y;
+    }
+    return Mem;
+}
+
+/******************************************************************************
+function: Copy a window from a background image into the selected image
+parameter:
+    ctx    : Paint context
+    Background : Image with the same size and depth as the selected image
+    Xstart     : x starting point
+    Ystart     : Y starting point
+    Xend       : x end point (exclusive)
+    Yend       : y end point (exclusive)
+info:
+    Used to undo drawing (text, bars) without redrawing the whole screen.
+******************************************************************************/
+void Paint_RestoreWindow_ctx(PAINT *ctx, const UWORD *Background, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
+{
+    PAINT_RECT Rect = {Xstart, Ystart, Xend, Yend};
+    UDOUBLE Bytes = (ctx->Depth == 8) ? 1 : 2;
+    UDOUBLE Offset;
+    UWORD Y;
+
+    if(ctx->Depth == 1)
+        return;
+    Rect = Paint_RectMemory_ctx(ctx, Rect);
+    for(Y = Rect.Ystart; Y < Rect.Yend; Y++) {
+        Offset = ((UDOUBLE)Y * ctx->WidthByte + Rect.Xstart) * Bytes;
+        memcpy((UBYTE *)ctx->Image + Offset, (const UBYTE *)Background + Offset, (Rect.Xend - Rect.Xstart) * Bytes);
+    }
+}
+
+/******************************************************************************
+function: Move the contents of a window left or right in the image
+parameter:
+    ctx    : Paint context
+    Xstart : x starting point
+    Ystart : Y starting point
+    Xend   : x end point (exclusive)
+    Yend   : y end point (exclusive)
+    Dx     : Pixels to move, negative moves left
+info:
+    The columns uncovered by the move keep their old contents and must be
+    drawn by the caller. Depending on the rotation a column of the window
+    is either a run of a memory row (one memmove per row) or a whole memory
+    row (one memmove for the window).
+******************************************************************************/
+void Paint_ScrollWindow_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, int Dx)
+{
+    PAINT_RECT Rect = {Xstart, Ystart, Xend, Yend};
+    int Bytes = (ctx->Depth == 8) ? 1 : 2;
+    int Stride = ctx->WidthByte * Bytes;
+    UBYTE *Base;
+    int Shift, Rows, Length, Y;
+
+    if(ctx->Depth == 1 || Dx == 0)
+        return;
+    Rect = Paint_RectMemory_ctx(ctx, Rect);
+    if(Rect.Xstart >= Rect.Xend)
+        return;
+
+    //direction of drawing +x in memory
+    Shift = (ctx->Rotate == 180 || ctx->Rotate == 270) ? -Dx : Dx;
+    if(ctx->Rotate == 90 || ctx->Rotate == 270) {
+        if(ctx->Mirror & MIRROR_VERTICAL) Shift = -Shift;
+        Rows = Rect.Yend - Rect.Ystart;
+        if(Shift >= Rows || -Shift >= Rows)
+            return;
+        Length = (Rect.Xend - Rect.Xstart) * Bytes;
+        Base = (UBYTE *)ctx->Image + Rect.Ystart * Stride + Rect.Xstart * Bytes;
+        if(Length == Stride) {
+            //full width rows are contiguous, move them in one go
+            if(Shift > 0)
+                memmove(Base + Shift * Stride, Base, (Rows - Shift) * Stride);
+            else
+                memmove(Base, Base - Shift * Stride, (Rows + Shift) * Stride);
+        } else if(Shift > 0) {
+            for(Y = Rows - 1; Y >= Shift; Y--)
+                memmove(Base + Y * Stride, Base + (Y - Shift) * Stride, Length);
+        } else {
+            for(Y = 0; Y < Rows + Shift; Y++)
+                memmove(Base + Y * Stride, Base + (Y - Shift) * Stride, Length);
         }
+        return;
+    }
+
+    if(ctx->Mirror & MIRROR_HORIZONTAL) Shift = -Shift;
+    Length = Rect.Xend - Rect.Xstart;
+    if(Shift >= Length || -Shift >= Length)
+        return;
+    for(Y = Rect.Ystart; Y < Rect.Yend; Y++) {
+        Base = (UBYTE *)ctx->Image + Y * Stride + Rect.Xstart * Bytes;
+        if(Shift > 0)
+            memmove(Base + Shift * Bytes, Base, (Length - Shift) * Bytes);
+        else
+            memmove(Base, Base - Shift * Bytes, (Length + Shift) * Bytes);
     }
 }
 
 /******************************************************************************
 function: Draw Point(Xpoint, Ypoint) Fill the color
 parameter:
+    ctx    : Paint context
     Xpoint		: The Xpoint coordinate of the point
     Ypoint		: The Ypoint coordinate of the point
     Color		: Painted color
     Dot_Pixel	: point size
     Dot_Style	: point Style
 ******************************************************************************/
-void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
+void Paint_DrawPoint_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, UWORD Color,
                      DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_Style)
 {
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > ctx->Width || Ypoint > ctx->Height) {
         DEBUG("Paint_DrawPoint Input exceeds the normal display range\r\n");
         return;
     }
@@ -258,13 +725,13 @@ void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
                     break;
 				//DEBUG("Paint_DrawPoint x:%d y:%d color:0x%x\r\n",Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel,Color);
                 //printf("x = %d, y = %d\r\n", Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel);
-                Paint_SetPixel(Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel, Color);
+                Paint_SetPixel_ctx(ctx, Xpoint + XDir_Num - Dot_Pixel, Ypoint + YDir_Num - Dot_Pixel, Color);
             }
         }
     } else {
         for (XDir_Num = 0; XDir_Num <  Dot_Pixel; XDir_Num++) {
             for (YDir_Num = 0; YDir_Num <  Dot_Pixel; YDir_Num++) {
-                Paint_SetPixel(Xpoint + XDir_Num - 1, Ypoint + YDir_Num - 1, Color);
+                Paint_SetPixel_ctx(ctx, Xpoint + XDir_Num - 1, Ypoint + YDir_Num - 1, Color);
 				
             }
         }
@@ -275,6 +742,7 @@ void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
 /******************************************************************************
 function: Draw a line of arbitrary slope
 parameter:
+    ctx    : Paint context
     Xstart ：Starting Xpoint point coordinates
     Ystart ：Starting Xpoint point coordinates
     Xend   ：End point Xpoint coordinate
@@ -283,11 +751,11 @@ parameter:
     Line_width : Line width
     Line_Style: Solid and dotted lines
 ******************************************************************************/
-void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+void Paint_DrawLine_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
                     UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style)
 {
-    if (Xstart > Paint.Width || Ystart > Paint.Height ||
-        Xend > Paint.Width || Yend > Paint.Height) {
+    if (Xstart > ctx->Width || Ystart > ctx->Height ||
+        Xend > ctx->Width || Yend > ctx->Height) {
         DEBUG("Paint_DrawLine Input exceeds the normal display range\r\n");
         return;
     }
@@ -310,10 +778,10 @@ void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
         //Painted dotted line, 2 point is really virtual
         if (Line_Style == LINE_STYLE_DOTTED && Dotted_Len % 3 == 0) {
             //DEBUG("LINE_DOTTED\r\n");
-            Paint_DrawPoint(Xpoint, Ypoint, IMAGE_BACKGROUND, Line_width, DOT_STYLE_DFT);
+            Paint_DrawPoint_ctx(ctx, Xpoint, Ypoint, IMAGE_BACKGROUND, Line_width, DOT_STYLE_DFT);
             Dotted_Len = 0;
         } else {
-            Paint_DrawPoint(Xpoint, Ypoint, Color, Line_width, DOT_STYLE_DFT);
+            Paint_DrawPoint_ctx(ctx, Xpoint, Ypoint, Color, Line_width, DOT_STYLE_DFT);
         }
         if (2 * Esp >= dy) {
             if (Xpoint == Xend)
@@ -333,6 +801,7 @@ void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
 /******************************************************************************
 function: Draw a rectangle
 parameter:
+    ctx    : Paint context
     Xstart ：Rectangular  Starting Xpoint point coordinates
     Ystart ：Rectangular  Starting Xpoint point coordinates
     Xend   ：Rectangular  End point Xpoint coordinate
@@ -341,11 +810,11 @@ parameter:
     Line_width: Line width
     Draw_Fill : Whether to fill the inside of the rectangle
 ******************************************************************************/
-void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+void Paint_DrawRectangle_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
                          UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
 {
-    if (Xstart > Paint.Width || Ystart > Paint.Height ||
-        Xend > Paint.Width || Yend > Paint.Height) {
+    if (Xstart > ctx->Width || Ystart > ctx->Height ||
+        Xend > ctx->Width || Yend > ctx->Height) {
         DEBUG("Input exceeds the normal display range\r\n");
         return;
     }
@@ -353,20 +822,21 @@ void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
     if (Draw_Fill) {
         UWORD Ypoint;
         for(Ypoint = Ystart; Ypoint < Yend; Ypoint++) {
-            Paint_DrawLine(Xstart, Ypoint, Xend, Ypoint, Color , Line_width, LINE_STYLE_SOLID);
+            Paint_DrawLine_ctx(ctx, Xstart, Ypoint, Xend, Ypoint, Color , Line_width, LINE_STYLE_SOLID);
         }
     } else {
-        Paint_DrawLine(Xstart, Ystart, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
-        Paint_DrawLine(Xstart, Ystart, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
-        Paint_DrawLine(Xend, Yend, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
-        Paint_DrawLine(Xend, Yend, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
+        Paint_DrawLine_ctx(ctx, Xstart, Ystart, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
+        Paint_DrawLine_ctx(ctx, Xstart, Ystart, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
+        Paint_DrawLine_ctx(ctx, Xend, Yend, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
+        Paint_DrawLine_ctx(ctx, Xend, Yend, Xstart, Yend, Color, Line_width, LINE_STYLE_SOLID);
     }
 }
 
 /******************************************************************************
 function: Use the 8-point method to draw a circle of the
-            specified size at the specified position->
+            specified size at the specified position.
 parameter:
+    ctx    : Paint context
     X_Center  ：Center X coordinate
     Y_Center  ：Center Y coordinate
     Radius    ：circle Radius
@@ -374,10 +844,10 @@ parameter:
     Line_width: Line width
     Draw_Fill : Whether to fill the inside of the Circle
 ******************************************************************************/
-void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
+void Paint_DrawCircle_ctx(PAINT *ctx, UWORD X_Center, UWORD Y_Center, UWORD Radius,
                       UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
 {
-    if (X_Center > Paint.Width || Y_Center >= Paint.Height) {
+    if (X_Center > ctx->Width || Y_Center >= ctx->Height) {
         DEBUG("Paint_DrawCircle Input exceeds the normal display range\r\n");
         return;
     }
@@ -394,14 +864,14 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
     if (Draw_Fill == DRAW_FILL_FULL) {
         while (XCurrent <= YCurrent ) { //Realistic circles
             for (sCountY = XCurrent; sCountY <= YCurrent; sCountY ++ ) {
-                Paint_DrawPoint(X_Center + XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//1
-                Paint_DrawPoint(X_Center - XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//2
-                Paint_DrawPoint(X_Center - sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//3
-                Paint_DrawPoint(X_Center - sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//4
-                Paint_DrawPoint(X_Center - XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//5
-                Paint_DrawPoint(X_Center + XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//6
-                Paint_DrawPoint(X_Center + sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//7
-                Paint_DrawPoint(X_Center + sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                Paint_DrawPoint_ctx(ctx, X_Center + XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//1
+                Paint_DrawPoint_ctx(ctx, X_Center - XCurrent, Y_Center + sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//2
+                Paint_DrawPoint_ctx(ctx, X_Center - sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//3
+                Paint_DrawPoint_ctx(ctx, X_Center - sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//4
+                Paint_DrawPoint_ctx(ctx, X_Center - XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//5
+                Paint_DrawPoint_ctx(ctx, X_Center + XCurrent, Y_Center - sCountY, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//6
+                Paint_DrawPoint_ctx(ctx, X_Center + sCountY, Y_Center - XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);//7
+                Paint_DrawPoint_ctx(ctx, X_Center + sCountY, Y_Center + XCurrent, Color, DOT_PIXEL_DFT, DOT_STYLE_DFT);
             }
             if (Esp < 0 )
                 Esp += 4 * XCurrent + 6;
@@ -413,14 +883,14 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
         }
     } else { //Draw a hollow circle
         while (XCurrent <= YCurrent ) {
-            Paint_DrawPoint(X_Center + XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//1
-            Paint_DrawPoint(X_Center - XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//2
-            Paint_DrawPoint(X_Center - YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//3
-            Paint_DrawPoint(X_Center - YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//4
-            Paint_DrawPoint(X_Center - XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//5
-            Paint_DrawPoint(X_Center + XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//6
-            Paint_DrawPoint(X_Center + YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//7
-            Paint_DrawPoint(X_Center + YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//0
+            Paint_DrawPoint_ctx(ctx, X_Center + XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//1
+            Paint_DrawPoint_ctx(ctx, X_Center - XCurrent, Y_Center + YCurrent, Color, Line_width, DOT_STYLE_DFT);//2
+            Paint_DrawPoint_ctx(ctx, X_Center - YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//3
+            Paint_DrawPoint_ctx(ctx, X_Center - YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//4
+            Paint_DrawPoint_ctx(ctx, X_Center - XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//5
+            Paint_DrawPoint_ctx(ctx, X_Center + XCurrent, Y_Center - YCurrent, Color, Line_width, DOT_STYLE_DFT);//6
+            Paint_DrawPoint_ctx(ctx, X_Center + YCurrent, Y_Center - XCurrent, Color, Line_width, DOT_STYLE_DFT);//7
+            Paint_DrawPoint_ctx(ctx, X_Center + YCurrent, Y_Center + XCurrent, Color, Line_width, DOT_STYLE_DFT);//0
 
             if (Esp < 0 )
                 Esp += 4 * XCurrent + 6;
@@ -436,6 +906,7 @@ void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
 /******************************************************************************
 function: Show English characters
 parameter:
+    ctx    : Paint context
     Xpoint           ：X coordinate
     Ypoint           ：Y coordinate
     Acsii_Char       ：To display the English characters
@@ -443,12 +914,12 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
+void Paint_DrawChar_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
                     sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
 {
     UWORD Page, Column;
 
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > ctx->Width || Ypoint > ctx->Height) {
         DEBUG("Paint_DrawChar Input exceeds the normal display range\r\n");
         return;
     }
@@ -462,15 +933,15 @@ void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
             //To determine whether the font background color and screen background color is consistent
             if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
                 if (*ptr & (0x80 >> (Column % 8)))
-                    Paint_SetPixel(Xpoint + Column, Ypoint + Page, Color_Foreground);
-                    // Paint_DrawPoint(Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                    Paint_SetPixel_ctx(ctx, Xpoint + Column, Ypoint + Page, Color_Foreground);
+                    // Paint_DrawPoint_ctx(ctx, Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
             } else {
                 if (*ptr & (0x80 >> (Column % 8))) {
-                    Paint_SetPixel(Xpoint + Column, Ypoint + Page, Color_Foreground);
-                    // Paint_DrawPoint(Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                    Paint_SetPixel_ctx(ctx, Xpoint + Column, Ypoint + Page, Color_Foreground);
+                    // Paint_DrawPoint_ctx(ctx, Xpoint + Column, Ypoint + Page, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                 } else {
-                    Paint_SetPixel(Xpoint + Column, Ypoint + Page, Color_Background);
-                    // Paint_DrawPoint(Xpoint + Column, Ypoint + Page, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                    Paint_SetPixel_ctx(ctx, Xpoint + Column, Ypoint + Page, Color_Background);
+                    // Paint_DrawPoint_ctx(ctx, Xpoint + Column, Ypoint + Page, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                 }
             }
             //One pixel is 8 bits
@@ -485,6 +956,7 @@ void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
 /******************************************************************************
 function:	Display the string
 parameter:
+    ctx    : Paint context
     Xstart           ：X coordinate
     Ystart           ：Y coordinate
     pString          ：The first address of the English string to be displayed
@@ -492,30 +964,30 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawString_EN(UWORD Xstart, UWORD Ystart, const char * pString,
+void Paint_DrawString_EN_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, const char * pString,
                          sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
 {
     UWORD Xpoint = Xstart;
     UWORD Ypoint = Ystart;
 
-    if (Xstart > Paint.Width || Ystart > Paint.Height) {
+    if (Xstart > ctx->Width || Ystart > ctx->Height) {
         DEBUG("Paint_DrawString_EN Input exceeds the normal display range\r\n");
         return;
     }
 
     while (* pString != '\0') {
         //if X direction filled , reposition to(Xstart,Ypoint),Ypoint is Y direction plus the Height of the character
-        if ((Xpoint + Font->Width ) > Paint.Width ) {
+        if ((Xpoint + Font->Width ) > ctx->Width ) {
             Xpoint = Xstart;
             Ypoint += Font->Height;
         }
 
         // If the Y direction is full, reposition to(Xstart, Ystart)
-        if ((Ypoint  + Font->Height ) > Paint.Height ) {
+        if ((Ypoint  + Font->Height ) > ctx->Height ) {
             Xpoint = Xstart;
             Ypoint = Ystart;
         }
-        Paint_DrawChar(Xpoint, Ypoint, * pString, Font, Color_Background, Color_Foreground);
+        Paint_DrawChar_ctx(ctx, Xpoint, Ypoint, * pString, Font, Color_Background, Color_Foreground);
 
         //The next character of the address
         pString ++;
@@ -529,6 +1001,7 @@ void Paint_DrawString_EN(UWORD Xstart, UWORD Ystart, const char * pString,
 /******************************************************************************
 function:	Display the string
 parameter:
+    ctx    : Paint context
     Xstart           ：X coordinate
     Ystart           ：Y coordinate
     pString          ：The first address of the Chinese string and English
@@ -537,7 +1010,7 @@ parameter:
     Color_Background : Select the background color of the English character
     Color_Foreground : Select the foreground color of the English character
 ******************************************************************************/
-void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font, UWORD Color_Background, UWORD Color_Foreground)
+void Paint_DrawString_CN_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font, UWORD Color_Background, UWORD Color_Foreground)
 {
     const char* p_text = pString;
     int x = Xstart, y = Ystart;
@@ -554,16 +1027,16 @@ void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT
                         for (i = 0; i < font->Width; i++) {
                             if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
                                 if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                                    Paint_SetPixel_ctx(ctx, x + i, y + j, Color_Foreground);
+                                    // Paint_DrawPoint_ctx(ctx, x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                                 }
                             } else {
                                 if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                                    Paint_SetPixel_ctx(ctx, x + i, y + j, Color_Foreground);
+                                    // Paint_DrawPoint_ctx(ctx, x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                                 } else {
-                                    Paint_SetPixel(x + i, y + j, Color_Background);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                                    Paint_SetPixel_ctx(ctx, x + i, y + j, Color_Background);
+                                    // Paint_DrawPoint_ctx(ctx, x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                                 }
                             }
                             if (i % 8 == 7) {
@@ -590,16 +1063,16 @@ void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT
                         for (i = 0; i < font->Width; i++) {
                             if (FONT_BACKGROUND == Color_Background) { //this process is to speed up the scan
                                 if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                                    Paint_SetPixel_ctx(ctx, x + i, y + j, Color_Foreground);
+                                    // Paint_DrawPoint_ctx(ctx, x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                                 }
                             } else {
                                 if (*ptr & (0x80 >> (i % 8))) {
-                                    Paint_SetPixel(x + i, y + j, Color_Foreground);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                                    Paint_SetPixel_ctx(ctx, x + i, y + j, Color_Foreground);
+                                    // Paint_DrawPoint_ctx(ctx, x + i, y + j, Color_Foreground, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                                 } else {
-                                    Paint_SetPixel(x + i, y + j, Color_Background);
-                                    // Paint_DrawPoint(x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
+                                    Paint_SetPixel_ctx(ctx, x + i, y + j, Color_Background);
+                                    // Paint_DrawPoint_ctx(ctx, x + i, y + j, Color_Background, DOT_PIXEL_DFT, DOT_STYLE_DFT);
                                 }
                             }
                             if (i % 8 == 7) {
@@ -626,6 +1099,7 @@ void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT
 /******************************************************************************
 function:	Display nummber
 parameter:
+    ctx    : Paint context
     Xstart           ：X coordinate
     Ystart           : Y coordinate
     Nummber          : The number displayed
@@ -634,7 +1108,7 @@ parameter:
     Color_Background : Select the background color
 ******************************************************************************/
 #define  ARRAY_LEN 255
-void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
+void Paint_DrawNum_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
                    sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
 {
 
@@ -642,7 +1116,7 @@ void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
     uint8_t Str_Array[ARRAY_LEN] = {0}, Num_Array[ARRAY_LEN] = {0};
     uint8_t *pStr = Str_Array;
 
-    if (Xpoint > Paint.Width || Ypoint > Paint.Height) {
+    if (Xpoint > ctx->Width || Ypoint > ctx->Height) {
         DEBUG("Paint_DisNum Input exceeds the normal display range\r\n");
         return;
     }
@@ -662,11 +1136,12 @@ void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
     }
 
     //show
-    Paint_DrawString_EN(Xpoint, Ypoint, (const char*)pStr, Font, Color_Foreground , Color_Background);
+    Paint_DrawString_EN_ctx(ctx, Xpoint, Ypoint, (const char*)pStr, Font, Color_Foreground , Color_Background);
 }
 /******************************************************************************
 function:	Display Float Nummber
 parameter:
+    ctx    : Paint context
     Xstart           ：X coordinate
     Ystart           : Y coordinate
     Nummber          : The float data that you want to display
@@ -674,7 +1149,7 @@ parameter:
     Font             ：A structure pointer that displays a character size
     Color            : Select the background color of the English character
 ******************************************************************************/
-void Paint_DrawFloatNum(UWORD Xpoint, UWORD Ypoint, double Nummber,  UBYTE Decimal_Point, 
+void Paint_DrawFloatNum_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, double Nummber,  UBYTE Decimal_Point, 
                         sFONT* Font,  UWORD Color_Foreground, UWORD  Color_Background)
 {
     char Str[ARRAY_LEN];
@@ -683,7 +1158,7 @@ void Paint_DrawFloatNum(UWORD Xpoint, UWORD Ypoint, double Nummber,  UBYTE Decim
     memcpy(pStr,Str,(strlen(Str)-1));
     * (pStr+strlen(Str)-1)='\0';
     //show
-    Paint_DrawString_EN(Xpoint, Ypoint, (const char*)pStr, Font, Color_Foreground , Color_Background);
+    Paint_DrawString_EN_ctx(ctx, Xpoint, Ypoint, (const char*)pStr, Font, Color_Foreground , Color_Background);
     free(pStr);
     pStr=NULL;
 }
@@ -691,6 +1166,7 @@ void Paint_DrawFloatNum(UWORD Xpoint, UWORD Ypoint, double Nummber,  UBYTE Decim
 /******************************************************************************
 function:	Display time
 parameter:
+    ctx    : Paint context
     Xstart           ：X coordinate
     Ystart           : Y coordinate
     pTime            : Time-related structures
@@ -698,7 +1174,7 @@ parameter:
     Color_Foreground : Select the foreground color
     Color_Background : Select the background color
 ******************************************************************************/
-void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
+void Paint_DrawTime_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
                     UWORD Color_Foreground, UWORD Color_Background)
 {
     uint8_t value[10] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
@@ -706,32 +1182,33 @@ void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
     UWORD Dx = Font->Width;
 
     //Write data into the cache
-    Paint_DrawChar(Xstart                           , Ystart, value[pTime->Hour / 10], Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx                      , Ystart, value[pTime->Hour % 10], Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx  + Dx / 4 + Dx / 2   , Ystart, ':'                    , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 2 + Dx / 2         , Ystart, value[pTime->Min / 10] , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 3 + Dx / 2         , Ystart, value[pTime->Min % 10] , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 4 + Dx / 2 - Dx / 4, Ystart, ':'                    , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 5                  , Ystart, value[pTime->Sec / 10] , Font, Color_Background, Color_Foreground);
-    Paint_DrawChar(Xstart + Dx * 6                  , Ystart, value[pTime->Sec % 10] , Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart                           , Ystart, value[pTime->Hour / 10], Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx                      , Ystart, value[pTime->Hour % 10], Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx  + Dx / 4 + Dx / 2   , Ystart, ':'                    , Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx * 2 + Dx / 2         , Ystart, value[pTime->Min / 10] , Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx * 3 + Dx / 2         , Ystart, value[pTime->Min % 10] , Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx * 4 + Dx / 2 - Dx / 4, Ystart, ':'                    , Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx * 5                  , Ystart, value[pTime->Sec / 10] , Font, Color_Background, Color_Foreground);
+    Paint_DrawChar_ctx(ctx, Xstart + Dx * 6                  , Ystart, value[pTime->Sec % 10] , Font, Color_Background, Color_Foreground);
 }
 
 /******************************************************************************
 function:	Display image
 parameter:
+    ctx    : Paint context
     image            ：Image start address
     xStart           : X starting coordinates
     yStart           : Y starting coordinates
     xEnd             ：Image width
     yEnd             : Image height
 ******************************************************************************/
-void Paint_DrawImage(const unsigned char *image, UWORD xStart, UWORD yStart, UWORD W_Image, UWORD H_Image) 
+void Paint_DrawImage_ctx(PAINT *ctx, const unsigned char *image, UWORD xStart, UWORD yStart, UWORD W_Image, UWORD H_Image)
 {
     int i,j; 
 		for(j = 0; j < H_Image; j++){
 			for(i = 0; i < W_Image; i++){
-				if(xStart+i < Paint.WidthMemory  &&  yStart+j < Paint.HeightMemory)//Exceeded part does not display
-					Paint_SetPixel(xStart + i, yStart + j, (*(image + j*W_Image*2 + i*2+1))<<8 | (*(image + j*W_Image*2 + i*2)));
+				if(xStart+i < ctx->WidthMemory  &&  yStart+j < ctx->HeightMemory)//Exceeded part does not display
+					Paint_SetPixel_ctx(ctx, xStart + i, yStart + j, (*(image + j*W_Image*2 + i*2+1))<<8 | (*(image + j*W_Image*2 + i*2)));
 				//Using arrays is a property of sequential storage, accessing the original array by algorithm
 				//j*W_Image*2 			   Y offset
 				//i*2              	   X offset
@@ -743,20 +1220,21 @@ void Paint_DrawImage(const unsigned char *image, UWORD xStart, UWORD yStart, UWO
 /******************************************************************************
 function:	Display monochrome bitmap
 parameter:
+    ctx    : Paint context
     image_buffer ：A picture data converted to a bitmap
 info:
     Use a computer to convert the image into a corresponding array,
     and then embed the array directly into Imagedata.cpp as a .c file.
 ******************************************************************************/
-void Paint_DrawBitMap(const unsigned char* image_buffer)
+void Paint_DrawBitMap_ctx(PAINT *ctx, const unsigned char* image_buffer)
 {
     UWORD x, y;
     UDOUBLE Addr = 0;
 
-    for (y = 0; y < Paint.HeightByte; y++) {
-        for (x = 0; x < Paint.WidthByte; x++) {//8 pixel =  1 byte
-            Addr = x + y * Paint.WidthByte;
-            Paint.Image[Addr] = (unsigned char)image_buffer[Addr];
+    for (y = 0; y < ctx->HeightByte; y++) {
+        for (x = 0; x < ctx->WidthByte; x++) {//8 pixel =  1 byte
+            Addr = x + y * ctx->WidthByte;
+            ctx->Image[Addr] = (unsigned char)image_buffer[Addr];
         }
     }
 }
@@ -795,3 +1273,139 @@ void GUI_Partial_Refresh(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
     LCD_1in54_DisplayWindows(X0, Y0, X1, Y1, Paint.Image);
 }
 */
+
+/******************************************************************************
+function: Functions drawing on the global Paint context.
+info:
+    Kept so existing code does not change. New code that renders more than
+    one image, or renders from another thread, should use its own PAINT
+    context with the _ctx functions.
+******************************************************************************/
+void Paint_NewImage(UWORD *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color, UWORD Depth)
+{
+    Paint_NewImage_ctx(&Paint, image, Width, Height, Rotate, Color, Depth);
+}
+
+void Paint_SelectImage(UWORD *image)
+{
+    Paint_SelectImage_ctx(&Paint, image);
+}
+
+void Paint_SetRotate(UWORD Rotate)
+{
+    Paint_SetRotate_ctx(&Paint, Rotate);
+}
+
+void Paint_SetMirroring(UBYTE mirror)
+{
+    Paint_SetMirroring_ctx(&Paint, mirror);
+}
+
+void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
+{
+    Paint_SetPixel_ctx(&Paint, Xpoint, Ypoint, Color);
+}
+
+void Paint_Clear(UWORD Color)
+{
+    Paint_Clear_ctx(&Paint, Color);
+}
+
+void Paint_ClearWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
+{
+    Paint_ClearWindow_ctx(&Paint, Xstart, Ystart, Xend, Yend, Color);
+}
+
+void Paint_SetPalette(PAINT_PALETTE *Palette)
+{
+    Paint_SetPalette_ctx(&Paint, Palette);
+}
+
+void Paint_ImportImage(const unsigned char *image)
+{
+    Paint_ImportImage_ctx(&Paint, image);
+}
+
+PAINT_RECT Paint_RectMemory(PAINT_RECT Rect)
+{
+    return Paint_RectMemory_ctx(&Paint, Rect);
+}
+
+void Paint_RestoreWindow(const UWORD *Background, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
+{
+    Paint_RestoreWindow_ctx(&Paint, Background, Xstart, Ystart, Xend, Yend);
+}
+
+void Paint_ScrollWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, int Dx)
+{
+    Paint_ScrollWindow_ctx(&Paint, Xstart, Ystart, Xend, Yend, Dx);
+}
+
+void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color,
+                     DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_Style)
+{
+    Paint_DrawPoint_ctx(&Paint, Xpoint, Ypoint, Color, Dot_Pixel, Dot_Style);
+}
+
+void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+                    UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style)
+{
+    Paint_DrawLine_ctx(&Paint, Xstart, Ystart, Xend, Yend, Color, Line_width, Line_Style);
+}
+
+void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
+                         UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
+{
+    Paint_DrawRectangle_ctx(&Paint, Xstart, Ystart, Xend, Yend, Color, Line_width, Draw_Fill);
+}
+
+void Paint_DrawCircle(UWORD X_Center, UWORD Y_Center, UWORD Radius,
+                      UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill)
+{
+    Paint_DrawCircle_ctx(&Paint, X_Center, Y_Center, Radius, Color, Line_width, Draw_Fill);
+}
+
+void Paint_DrawChar(UWORD Xpoint, UWORD Ypoint, const char Acsii_Char,
+                    sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    Paint_DrawChar_ctx(&Paint, Xpoint, Ypoint, Acsii_Char, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawString_EN(UWORD Xstart, UWORD Ystart, const char * pString,
+                         sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    Paint_DrawString_EN_ctx(&Paint, Xstart, Ystart, pString, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawString_CN(UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font, UWORD Color_Background, UWORD Color_Foreground)
+{
+    Paint_DrawString_CN_ctx(&Paint, Xstart, Ystart, pString, font, Color_Background, Color_Foreground);
+}
+
+void Paint_DrawNum(UWORD Xpoint, UWORD Ypoint, int32_t Nummber,
+                   sFONT* Font, UWORD Color_Foreground, UWORD Color_Background)
+{
+    Paint_DrawNum_ctx(&Paint, Xpoint, Ypoint, Nummber, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawFloatNum(UWORD Xpoint, UWORD Ypoint, double Nummber,  UBYTE Decimal_Point, 
+                        sFONT* Font,  UWORD Color_Foreground, UWORD  Color_Background)
+{
+    Paint_DrawFloatNum_ctx(&Paint, Xpoint, Ypoint, Nummber, Decimal_Point, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
+                    UWORD Color_Foreground, UWORD Color_Background)
+{
+    Paint_DrawTime_ctx(&Paint, Xstart, Ystart, pTime, Font, Color_Foreground, Color_Background);
+}
+
+void Paint_DrawImage(const unsigned char *image, UWORD xStart, UWORD yStart, UWORD W_Image, UWORD H_Image)
+{
+    Paint_DrawImage_ctx(&Paint, image, xStart, yStart, W_Image, H_Image);
+}
+
+void Paint_DrawBitMap(const unsigned char* image_buffer)
+{
+    Paint_DrawBitMap_ctx(&Paint, image_buffer);
+}
@@ -48,8 +48,25 @@ typedef enum {
 } MIRROR_IMAGE;
 #define MIRROR_IMAGE_DFT MIRROR_NONE
 /**
- * Image attributes
+ * Indexed colour palette, used when Depth is 8.
+ * Entries are RGB565 stored in panel byte order so the flush can copy
+ * them straight to SPI. Hash caches colour -> index lookups, 0 is empty.
 **/
+#define PALETTE_SIZE        256
+#define PALETTE_HASH_SIZE   4096
+
+typedef struct {
+    UWORD Color[PALETTE_SIZE];
+    UWORD Count;
+    UDOUBLE Hash[PALETTE_HASH_SIZE];
+} PAINT_PALETTE;
+
+/**
+ * Image attributes, one per image being drawn (a Paint context).
+ * Paint is the context used by the functions without _ctx.
+ * Cache holds recent colour -> palette index lookups of this context.
+**/
+#define PAINT_CACHE_SIZE    64
 
 typedef struct {
     UWORD *Image;
@@ -64,6 +81,8 @@ typedef struct {
     UWORD HeightByte;
     UWORD Depth;
     UBYTE Mode;
+    PAINT_PALETTE *Palette;
+    UDOUBLE Cache[PAINT_CACHE_SIZE];
 } PAINT;
 extern PAINT Paint;
 
@@ -142,6 +161,17 @@ typedef struct {
 } PAINT_TIME;
 extern PAINT_TIME sPaint_time;
 
+/**
+ * Rectangle, used to report the area changed by a drawing call.
+ * Xend and Yend are exclusive, the rectangle is empty when Xstart >= Xend.
+**/
+typedef struct {
+    UWORD Xstart;
+    UWORD Ystart;
+    UWORD Xend;
+    UWORD Yend;
+} PAINT_RECT;
+
 //init and Clear
 void Paint_NewImage(UWORD *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color, UWORD Depth);
 void Paint_SelectImage(UWORD *image);
@@ -152,6 +182,22 @@ void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color);
 void Paint_Clear(UWORD Color);
 void Paint_ClearWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
 
+//Indexed colour (Depth 8)
+void Paint_SetPalette(PAINT_PALETTE *Palette);
+void Paint_PaletteInit(PAINT_PALETTE *Palette);
+UBYTE Paint_PaletteAdd(PAINT_PALETTE *Palette, UWORD Color);
+UBYTE Paint_PaletteIndex(PAINT_PALETTE *Palette, UWORD Color);
+UBYTE Paint_PaletteLookup(const PAINT_PALETTE *Palette, UWORD Color);
+void Paint_PaletteSetEntry(PAINT_PALETTE *Palette, UBYTE Index, UWORD Color);
+void Paint_PaletteBuild(PAINT_PALETTE *Palette, const unsigned char *image[], UBYTE Count, UDOUBLE Pixels);
+void Paint_ImportImage(const unsigned char *image);
+
+//Damage rectangles
+void Paint_RectUnion(PAINT_RECT *Rect, PAINT_RECT Add);
+PAINT_RECT Paint_RectMemory(PAINT_RECT Rect);
+void Paint_RestoreWindow(const UWORD *Background, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend);
+void Paint_ScrollWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, int Dx);
+
 //Drawing
 void Paint_DrawPoint(UWORD Xpoint, UWORD Ypoint, UWORD Color, DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_FillWay);
 void Paint_DrawLine(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style);
@@ -170,6 +216,43 @@ void Paint_DrawTime(UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font,
 void Paint_DrawImage(const unsigned char *image,UWORD Startx, UWORD Starty,UWORD Endx, UWORD Endy); 
 
 
+//Same functions on a given Paint context, the ones above use the global Paint
+void Paint_NewImage_ctx(PAINT *ctx, UWORD *image, UWORD Width, UWORD Height, UWORD Rotate, UWORD Color, UWORD Depth);
+void Paint_SelectImage_ctx(PAINT *ctx, UWORD *image);
+void Paint_SetRotate_ctx(PAINT *ctx, UWORD Rotate);
+void Paint_SetMirroring_ctx(PAINT *ctx, UBYTE mirror);
+void Paint_SetPixel_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, UWORD Color);
+
+void Paint_Clear_ctx(PAINT *ctx, UWORD Color);
+void Paint_ClearWindow_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color);
+
+//Indexed colour (Depth 8)
+void Paint_SetPalette_ctx(PAINT *ctx, PAINT_PALETTE *Palette);
+void Paint_ImportImage_ctx(PAINT *ctx, const unsigned char *image);
+
+//Damage rectangles
+PAINT_RECT Paint_RectMemory_ctx(PAINT *ctx, PAINT_RECT Rect);
+void Paint_RestoreWindow_ctx(PAINT *ctx, const UWORD *Background, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend);
+void Paint_ScrollWindow_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, int Dx);
+
+//Drawing
+void Paint_DrawPoint_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, UWORD Color, DOT_PIXEL Dot_Pixel, DOT_STYLE Dot_FillWay);
+void Paint_DrawLine_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Line_width, LINE_STYLE Line_Style);
+void Paint_DrawRectangle_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill);
+void Paint_DrawCircle_ctx(PAINT *ctx, UWORD X_Center, UWORD Y_Center, UWORD Radius, UWORD Color, DOT_PIXEL Line_width, DRAW_FILL Draw_Fill);
+
+//Display string
+void Paint_DrawChar_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, const char Acsii_Char, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+void Paint_DrawString_EN_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, const char * pString, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+void Paint_DrawString_CN_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, const char * pString, cFONT* font, UWORD Color_Foreground, UWORD Color_Background);
+void Paint_DrawNum_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, int32_t Nummber, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+void Paint_DrawFloatNum_ctx(PAINT *ctx, UWORD Xpoint, UWORD Ypoint, double Nummber,  UBYTE Decimal_Point,	sFONT* Font,  UWORD Color_Foreground, UWORD  Color_Background);
+void Paint_DrawTime_ctx(PAINT *ctx, UWORD Xstart, UWORD Ystart, PAINT_TIME *pTime, sFONT* Font, UWORD Color_Foreground, UWORD Color_Background);
+
+//pic
+void Paint_DrawImage_ctx(PAINT *ctx, const unsigned char *image,UWORD Startx, UWORD Starty,UWORD Endx, UWORD Endy); 
+
+
 //void GUI_Partial_Refresh(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend);
 #endif
 
@@ -0,0 +1,658 @@
+/*****************************************************************************
+* | File      	:   GUI_Widget.c
+* | Author      :   NASsie
+* | Function    :   Bar, gauge and segmented meter widgets
+* | Info        :
+*                Widgets remember what they last drew. An update draws (or
+*                clears back to the background colour) only the pixels
+*                between the old and the new value and returns the changed
+*                rectangle, so the caller can send just that window to the LCD.
+*                The widget must be invalidated when the image under it is
+*                replaced (new background), the next update then draws it all.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :   Basic version
+*
+******************************************************************************/
+#include "GUI_Widget.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/******************************************************************************
+function: Colour for a value from a threshold table
+parameter:
+    Threshold  : Table sorted by Value
+    Thresholds : Number of entries
+    Fill       : WIDGET_FILL_GRADIENT blends between entries,
+                 WIDGET_FILL_LEVEL uses the last entry at or below Value
+    Value      : Value to look up
+******************************************************************************/
+UWORD Widget_ThresholdColor(const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, int Value)
+{
+    UBYTE i;
+
+    if(Thresholds == 0)
+        return BLACK;
+    if(Value <= Threshold[0].Value)
+        return Threshold[0].Color;
+
+    for(i = 1; i < Thresholds; i++) {
+        if(Value < Threshold[i].Value)
+            break;
+    }
+    if(i == Thresholds || Fill == WIDGET_FILL_LEVEL)
+        return Threshold[i - 1].Color;
+
+    //blend each RGB565 channel between the two stops
+    UWORD a = Threshold[i - 1].Color, b = Threshold[i].Color;
+    int Span = Threshold[i].Value - Threshold[i - 1].Value;
+    int t = Value - Threshold[i - 1].Value;
+    int r = (a >> 11) + (((int)(b >> 11) - (int)(a >> 11)) * t) / Span;
+    int g = ((a >> 5) & 0x3f) + (((int)((b >> 5) & 0x3f) - (int)((a >> 5) & 0x3f)) * t) / Span;
+    int bl = (a & 0x1f) + (((int)(b & 0x1f) - (int)(a & 0x1f)) * t) / Span;
+    return (r << 11) | (g << 5) | bl;
+}
+
+/******************************************************************************
+function: Create a bar
+parameter:
+    Bar        : Widget to initialise
+    Xstart     : Left edge
+    Ystart     : Top edge
+    Width      : Width in pixels
+    Height     : Height in pixels
+    Direction  : WIDGET_LEFT_RIGHT or WIDGET_BOTTOM_UP
+    Min, Max   : Value range, Min draws nothing and Max fills the bar
+    Threshold  : Threshold table, sorted by Value
+    Thresholds : Number of entries in the table
+    Fill       : Gradient along the bar or one colour for the current level
+    BackColor  : Colour of the empty part of the bar
+info:
+    The colour of every pixel along the bar is computed here, updates only
+    index the table.
+******************************************************************************/
+void Widget_BarInit(WIDGET_BAR *Bar, UWORD Xstart, UWORD Ystart, UWORD Width, UWORD Height,
+                    WIDGET_DIRECTION Direction, int Min, int Max,
+                    const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, UWORD BackColor)
+{
+    UWORD i;
+
+    memset(Bar, 0, sizeof(WIDGET_BAR));
+    Bar->Xstart = Xstart;
+    Bar->Ystart = Ystart;
+    Bar->Width = Width;
+    Bar->Height = Height;
+    Bar->Direction = Direction;
+    Bar->Min = Min;
+    Bar->Max = (Max > Min) ? Max : Min + 1;
+    Bar->Threshold = Threshold;
+    Bar->Thresholds = Thresholds;
+    Bar->Fill = Fill;
+    Bar->BackColor = BackColor;
+
+    Bar->Length = (Direction == WIDGET_LEFT_RIGHT) ? Width : Height;
+    if(Bar->Length > WIDGET_MAX_LENGTH)
+        Bar->Length = WIDGET_MAX_LENGTH;
+
+    //value at the middle of each pixel along the bar
+    for(i = 0; i < Bar->Length; i++) {
+        int Value = Bar->Min + ((2 * i + 1) * (Bar->Max - Bar->Min)) / (2 * Bar->Length);
+        Bar->Lut[i] = Widget_ThresholdColor(Threshold, Thresholds, WIDGET_FILL_GRADIENT, Value);
+    }
+}
+
+/******************************************************************************
+function: Create a segmented meter, a bar drawn as separate blocks
+parameter:
+    Segments : Number of segments
+    Gap      : Pixels between segments
+    others as Widget_BarInit
+info:
+    The length is trimmed so every segment has the same size.
+******************************************************************************/
+void Widget_MeterInit(WIDGET_BAR *Bar, UWORD Xstart, UWORD Ystart, UWORD Width, UWORD Height,
+                      WIDGET_DIRECTION Direction, int Min, int Max, UWORD Segments, UWORD Gap,
+                      const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, UWORD BackColor)
+{
+    Widget_BarInit(Bar, Xstart, Ystart, Width, Height, Direction, Min, Max, Threshold, Thresholds, Fill, BackColor);
+    if(Segments == 0)
+        return;
+    Bar->Gap = Gap;
+    Bar->Segment = (Bar->Length + Gap) / Segments;
+    if(Bar->Segment <= Gap) {
+        Bar->Segment = 0;
+        Bar->Gap = 0;
+        return;
+    }
+    Bar->Segment -= Gap;
+    Bar->Length = Segments * (Bar->Segment + Gap) - Gap;
+}
+
+/******************************************************************************
+function: Force the next update to draw the whole widget
+parameter:
+    Bar : Widget, e.g. after the background was copied over it
+******************************************************************************/
+void Widget_BarInvalidate(WIDGET_BAR *Bar)
+{
+    Bar->Drawn = 0;
+}
+
+//Draw positions [From, To) of the bar, filled below Level
+static PAINT_RECT Widget_BarSpan(PAINT *ctx, WIDGET_BAR *Bar, UWORD From, UWORD To)
+{
+    PAINT_RECT Rect = {0, 0, 0, 0};
+    UWORD Pos, i, Color;
+    UWORD Pitch = Bar->Segment + Bar->Gap;
+
+    if(From >= To)
+        return Rect;
+
+    for(Pos = From; Pos < To; Pos++) {
+        if(Pos >= Bar->Level || (Bar->Segment && Pos % Pitch >= Bar->Segment))
+            Color = Bar->BackColor;
+        else if(Bar->Fill == WIDGET_FILL_LEVEL)
+            Color = Bar->LevelColor;
+        else
+            Color = Bar->Lut[Pos];
+
+        if(Bar->Direction == WIDGET_LEFT_RIGHT) {
+            for(i = 0; i < Bar->Height; i++)
+                Paint_SetPixel_ctx(ctx, Bar->Xstart + Pos, Bar->Ystart + i, Color);
+        } else {
+            for(i = 0; i < Bar->Width; i++)
+                Paint_SetPixel_ctx(ctx, Bar->Xstart + i, Bar->Ystart + Bar->Height - 1 - Pos, Color);
+        }
+    }
+
+    if(Bar->Direction == WIDGET_LEFT_RIGHT) {
+        Rect.Xstart = Bar->Xstart + From;
+        Rect.Xend = Bar->Xstart + To;
+        Rect.Ystart = Bar->Ystart;
+        Rect.Yend = Bar->Ystart + Bar->Height;
+    } else {
+        Rect.Xstart = Bar->Xstart;
+        Rect.Xend = Bar->Xstart + Bar->Width;
+        Rect.Ystart = Bar->Ystart + Bar->Height - To;
+        Rect.Yend = Bar->Ystart + Bar->Height - From;
+    }
+    return Rect;
+}
+
+/******************************************************************************
+function: Show a new value on a bar
+parameter:
+    ctx   : Paint context to draw on
+    Bar   : Widget
+    Value : New value, clipped to the range of the bar
+info:
+    Returns the rectangle that changed, empty when nothing changed.
+******************************************************************************/
+PAINT_RECT Widget_BarUpdate_ctx(PAINT *ctx, WIDGET_BAR *Bar, int Value)
+{
+    UWORD Old = Bar->Level, New;
+    UWORD OldColor = Bar->LevelColor;
+
+    if(Value < Bar->Min) Value = Bar->Min;
+    if(Value > Bar->Max) Value = Bar->Max;
+    New = ((Value - Bar->Min) * Bar->Length) / (Bar->Max - Bar->Min);
+
+    //a segment is lit once the value reaches its end
+    if(Bar->Segment) {
+        UWORD Pitch = Bar->Segment + Bar->Gap;
+        UWORD Lit = (New + Bar->Gap) / Pitch;
+        New = Lit ? Lit * Pitch - Bar->Gap : 0;
+    }
+
+    Bar->Level = New;
+    Bar->LevelColor = Widget_ThresholdColor(Bar->Threshold, Bar->Thresholds, WIDGET_FILL_LEVEL, Value);
+
+    if(!Bar->Drawn) {
+        Bar->Drawn = 1;
+        return Widget_BarSpan(ctx, Bar, 0, Bar->Length);
+    }
+    if(Bar->Fill == WIDGET_FILL_LEVEL && Bar->LevelColor != OldColor)
+        return Widget_BarSpan(ctx, Bar, 0, (New > Old) ? New : Old);
+    if(New > Old)
+        return Widget_BarSpan(ctx, Bar, Old, New);
+    return Widget_BarSpan(ctx, Bar, New, Old);
+}
+
+static int Widget_GaugeCompare(const void *a, const void *b)
+{
+    UDOUBLE x = *(const UDOUBLE *)a, y = *(const UDOUBLE *)b;
+    return (x > y) - (x < y);
+}
+
+/******************************************************************************
+function: Create an arc gauge
+parameter:
+    Gauge      : Widget to initialise
+    X_Center   : Centre X coordinate
+    Y_Center   : Centre Y coordinate
+    Radius     : Outer radius, at most WIDGET_MAX_RADIUS
+    Thickness  : Width of the arc
+    Start      : Angle of Min, degrees clockwise from 12 o'clock
+    Sweep      : Degrees from Min to Max
+    others as Widget_BarInit
+info:
+    Every pixel of the arc is listed once, sorted by the step of the
+    gauge it belongs to, so an update walks only the pixels between the
+    old and new value. Returns 1 if the tables could not be allocated.
+******************************************************************************/
+UBYTE Widget_GaugeInit(WIDGET_GAUGE *Gauge, UWORD X_Center, UWORD Y_Center, UWORD Radius, UWORD Thickness,
+                       int Start, int Sweep, int Min, int Max,
+                       const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, UWORD BackColor)
+{
+    int dx, dy, r2, Inner, Outer;
+    UDOUBLE n = 0;
+    UWORD i;
+
+    memset(Gauge, 0, sizeof(WIDGET_GAUGE));
+    if(Radius > WIDGET_MAX_RADIUS) Radius = WIDGET_MAX_RADIUS;
+    if(Thickness > Radius) Thickness = Radius;
+    if(Sweep <= 0 || Sweep > 360) Sweep = 360;
+
+    Gauge->X_Center = X_Center;
+    Gauge->Y_Center = Y_Center;
+    Gauge->Radius = Radius;
+    Gauge->Thickness = Thickness;
+    Gauge->Start = Start;
+    Gauge->Sweep = Sweep;
+    Gauge->Min = Min;
+    Gauge->Max = (Max > Min) ? Max : Min + 1;
+    Gauge->Threshold = Threshold;
+    Gauge->Thresholds = Thresholds;
+    Gauge->Fill = Fill;
+    Gauge->BackColor = BackColor;
+
+    //one step per pixel along the outside of the arc
+    Gauge->Steps = (UWORD)(Sweep * M_PI * Radius / 180.0);
+    if(Gauge->Steps == 0)
+        Gauge->Steps = 1;
+
+    Outer = Radius * Radius;
+    Inner = (Radius - Thickness) * (Radius - Thickness);
+    for(dy = -Radius; dy <= Radius; dy++)
+        for(dx = -Radius; dx <= Radius; dx++) {
+            r2 = dx * dx + dy * dy;
+            if(r2 >= Inner && r2 <= Outer)
+                n++;
+        }
+
+    Gauge->Map = (UDOUBLE *)malloc(n * sizeof(UDOUBLE));
+    Gauge->Lut = (UWORD *)malloc(Gauge->Steps * sizeof(UWORD));
+    if(Gauge->Map == NULL || Gauge->Lut == NULL) {
+        Widget_GaugeFree(Gauge);
+        return 1;
+    }
+
+    for(dy = -Radius; dy <= Radius; dy++)
+        for(dx = -Radius; dx <= Radius; dx++) {
+            r2 = dx * dx + dy * dy;
+            if(r2 < Inner || r2 > Outer)
+                continue;
+            double Angle = atan2(dx, -dy) * 180.0 / M_PI - Start;
+            Angle = fmod(Angle + 720.0, 360.0);
+            if(Angle > Sweep)
+                continue;
+            UDOUBLE Step = (UDOUBLE)(Angle * Gauge->Steps / Sweep);
+            if(Step >= Gauge->Steps)
+                Step = Gauge->Steps - 1;
+            Gauge->Map[Gauge->Pixels++] = Step << 16 | (UDOUBLE)(dx + 128) << 8 | (UDOUBLE)(dy + 128);
+        }
+    qsort(Gauge->Map, Gauge->Pixels, sizeof(UDOUBLE), Widget_GaugeCompare);
+
+    for(i = 0; i < Gauge->Steps; i++) {
+        int Value = Gauge->Min + ((2 * i + 1) * (Gauge->Max - Gauge->Min)) / (2 * Gauge->Steps);
+        Gauge->Lut[i] = Widget_ThresholdColor(Threshold, Thresholds, WIDGET_FILL_GRADIENT, Value);
+    }
+    return 0;
+}
+
+/******************************************************************************
+function: Release the tables of a gauge
+parameter:
+    Gauge : Widget
+******************************************************************************/
+void Widget_GaugeFree(WIDGET_GAUGE *Gauge)
+{
+    free(Gauge->Map);
+    free(Gauge->Lut);
+    Gauge->Map = NULL;
+    Gauge->Lut = NULL;
+    Gauge->Pixels = 0;
+}
+
+/******************************************************************************
+function: Force the next update to draw the whole widget
+parameter:
+    Gauge : Widget
+******************************************************************************/
+void Widget_GaugeInvalidate(WIDGET_GAUGE *Gauge)
+{
+    Gauge->Drawn = 0;
+}
+
+//First entry of the map at or after Step
+static UDOUBLE Widget_GaugeFind(WIDGET_GAUGE *Gauge, UDOUBLE Step)
+{
+    UDOUBLE Low = 0, High = Gauge->Pixels, Mid;
+
+    while(Low < High) {
+        Mid = (Low + High) / 2;
+        if((Gauge->Map[Mid] >> 16) < Step)
+            Low = Mid + 1;
+        else
+            High = Mid;
+    }
+    return Low;
+}
+
+//Draw steps [From, To) of the gauge, filled below Level
+static PAINT_RECT Widget_GaugeSpan(PAINT *ctx, WIDGET_GAUGE *Gauge, UWORD From, UWORD To)
+{
+    PAINT_RECT Rect = {0, 0, 0, 0};
+    UDOUBLE i, End;
+    UWORD X, Y, Step, Color;
+
+    if(From >= To || Gauge->Map == NULL)
+        return Rect;
+
+    End = Widget_GaugeFind(Gauge, To);
+    Rect.Xstart = Rect.Ystart = 0xffff;
+    for(i = Widget_GaugeFind(Gauge, From); i < End; i++) {
+        Step = Gauge->Map[i] >> 16;
+        X = Gauge->X_Center + (int)((Gauge->Map[i] >> 8) & 0xff) - 128;
+        Y = Gauge->Y_Center + (int)(Gauge->Map[i] & 0xff) - 128;
+        if(Step >= Gauge->Level)
+            Color = Gauge->BackColor;
+        else if(Gauge->Fill == WIDGET_FILL_LEVEL)
+            Color = Gauge->LevelColor;
+        else
+            Color = Gauge->Lut[Step];
+        Paint_SetPixel_ctx(ctx, X, Y, Color);
+
+        if(X < Rect.Xstart) Rect.Xstart = X;
+        if(Y < Rect.Ystart) Rect.Ystart = Y;
+        if(X + 1 > Rect.Xend) Rect.Xend = X + 1;
+        if(Y + 1 > Rect.Yend) Rect.Yend = Y + 1;
+    }
+    if(Rect.Xstart > Rect.Xend)
+        Rect.Xstart = Rect.Ystart = 0;
+    return Rect;
+}
+
+/******************************************************************************
+function: Show a new value on a gauge
+parameter:
+    ctx   : Paint context to draw on
+    Gauge : Widget
+    Value : New value, clipped to the range of the gauge
+info:
+    Returns the rectangle that changed, empty when nothing changed.
+******************************************************************************/
+PAINT_RECT Widget_GaugeUpdate_ctx(PAINT *ctx, WIDGET_GAUGE *Gauge, int Value)
+{
+    UWORD Old = Gauge->Level, New;
+    UWORD OldColor = Gauge->LevelColor;
+
+    if(Value < Gauge->Min) Value = Gauge->Min;
+    if(Value > Gauge->Max) Value = Gauge->Max;
+    New = ((Value - Gauge->Min) * Gauge->Steps) / (Gauge->Max - Gauge->Min);
+
+    Gauge->Level = New;
+    Gauge->LevelColor = Widget_ThresholdColor(Gauge->Threshold, Gauge->Thresholds, WIDGET_FILL_LEVEL, Value);
+
+    if(!Gauge->Drawn) {
+        Gauge->Drawn = 1;
+        return Widget_GaugeSpan(ctx, Gauge, 0, Gauge->Steps);
+    }
+    if(Gauge->Fill == WIDGET_FILL_LEVEL && Gauge->LevelColor != OldColor)
+        return Widget_GaugeSpan(ctx, Gauge, 0, (New > Old) ? New : Old);
+    if(New > Old)
+        return Widget_GaugeSpan(ctx, Gauge, Old, New);
+    return Widget_GaugeSpan(ctx, Gauge, New, Old);
+}
+
+/******************************************************************************
+function: Create a history chart
+parameter:
+    Chart         : Widget to initialise
+    Xstart        : Left edge
+    Ystart        : Top edge
+    Width         : Width in pixels, one column per pixel
+    Height        : Height in pixels
+    Mode          : CHART_SCROLL or CHART_SWEEP
+    Min, Max      : Value range (starting range when AutoScale is set)
+    AutoScale     : Fit the range to the data in the chart
+    Decimate      : Samples per column
+    Color         : Colour of the average
+    EnvelopeColor : Colour between the minimum and maximum of a column
+    BackColor     : Chart background
+info:
+    Samples are recorded with Widget_ChartPush and drawn by
+    Widget_ChartUpdate, so a chart keeps collecting while it is not shown.
+******************************************************************************/
+void Widget_ChartInit(WIDGET_CHART *Chart, UWORD Xstart, UWORD Ystart, UWORD Width, UWORD Height,
+                      CHART_MODE Mode, int Min, int Max, UBYTE AutoScale, UWORD Decimate,
+                      UWORD Color, UWORD EnvelopeColor, UWORD BackColor)
+{
+    memset(Chart, 0, sizeof(WIDGET_CHART));
+    Chart->Xstart = Xstart;
+    Chart->Ystart = Ystart;
+    Chart->Width = (Width > CHART_MAX_WIDTH) ? CHART_MAX_WIDTH : Width;
+    Chart->Height = (Height > 1) ? Height : 2;
+    Chart->Mode = Mode;
+    Chart->Min = Min;
+    Chart->Max = (Max > Min) ? Max : Min + 1;
+    Chart->AutoScale = AutoScale;
+    Chart->Decimate = Decimate ? Decimate : 1;
+    Chart->Color = Color;
+    Chart->EnvelopeColor = EnvelopeColor;
+    Chart->BackColor = BackColor;
+}
+
+/******************************************************************************
+function: Record a sample
+parameter:
+    Chart : Widget
+    Value : Sample
+info:
+    Only updates the ring buffer, nothing is drawn.
+******************************************************************************/
+void Widget_ChartPush(WIDGET_CHART *Chart, int Value)
+{
+    CHART_COLUMN *Next = &Chart->Next;
+
+    if(Chart->Collected == 0) {
+        Next->Min = Next->Max = Next->Average = Value;
+    } else {
+        if(Value < Next->Min) Next->Min = Value;
+        if(Value > Next->Max) Next->Max = Value;
+        Next->Average += Value;     //sum until the column is complete
+    }
+
+    if(++Chart->Collected >= Chart->Decimate) {
+        Next->Average /= Chart->Collected;
+        Chart->Ring[Chart->Total % Chart->Width] = *Next;
+        Chart->Total++;
+        Chart->Collected = 0;
+    }
+}
+
+/******************************************************************************
+function: Force the next update to draw the whole chart
+parameter:
+    Chart : Widget
+******************************************************************************/
+void Widget_ChartInvalidate(WIDGET_CHART *Chart)
+{
+    Chart->Drawn = 0;
+}
+
+//Round up to 1, 2 or 5 times a power of 10
+static int Widget_NiceStep(int Step)
+{
+    int Power = 1;
+
+    while(Power * 10 <= Step)
+        Power *= 10;
+    if(Step <= Power) return Power;
+    if(Step <= 2 * Power) return 2 * Power;
+    if(Step <= 5 * Power) return 5 * Power;
+    return 10 * Power;
+}
+
+//Fit the range to the data, returns 1 when the range changed
+static UBYTE Widget_ChartScale(WIDGET_CHART *Chart)
+{
+    UDOUBLE i, Count = (Chart->Total < Chart->Width) ? Chart->Total : Chart->Width;
+    int Low, High, Step, Min, Max;
+
+    if(!Chart->AutoScale || Count == 0)
+        return 0;
+
+    Low = Chart->Ring[0].Min;
+    High = Chart->Ring[0].Max;
+    for(i = 1; i < Count; i++) {
+        if(Chart->Ring[i].Min < Low) Low = Chart->Ring[i].Min;
+        if(Chart->Ring[i].Max > High) High = Chart->Ring[i].Max;
+    }
+
+    //keep the scale unless the data is outside it or uses under half of it
+    if(Low >= Chart->Min && High <= Chart->Max && 2 * (High - Low) >= Chart->Max - Chart->Min)
+        return 0;
+
+    Step = Widget_NiceStep((High - Low) / 4 + 1);
+    Min = Low - ((Low % Step) + Step) % Step;
+    Max = Min + Step;
+    while(Max < High)
+        Max += Step;
+    if(Min == Chart->Min && Max == Chart->Max)
+        return 0;
+    Chart->Min = Min;
+    Chart->Max = Max;
+    return 1;
+}
+
+//Row of a value, 0 is the top of the chart
+static int Widget_ChartRow(WIDGET_CHART *Chart, int Value)
+{
+    if(Value < Chart->Min) Value = Chart->Min;
+    if(Value > Chart->Max) Value = Chart->Max;
+    return (Chart->Height - 1) - ((Value - Chart->Min) * (Chart->Height - 1)) / (Chart->Max - Chart->Min);
+}
+
+//Draw a whole column of the chart, Column NULL draws an empty one
+static void Widget_ChartColumn(PAINT *ctx, WIDGET_CHART *Chart, UWORD X, const CHART_COLUMN *Column)
+{
+    int Top = Chart->Height, Bottom = -1, Mid = -1, Y;
+    UWORD Color;
+
+    if(Column != NULL) {
+        Top = Widget_ChartRow(Chart, Column->Max);
+        Bottom = Widget_ChartRow(Chart, Column->Min);
+        Mid = Widget_ChartRow(Chart, Column->Average);
+    }
+    for(Y = 0; Y < Chart->Height; Y++) {
+        if(Y == Mid)
+            Color = Chart->Color;
+        else if(Y >= Top && Y <= Bottom)
+            Color = Chart->EnvelopeColor;
+        else
+            Color = Chart->BackColor;
+        Paint_SetPixel_ctx(ctx, Chart->Xstart + X, Chart->Ystart + Y, Color);
+    }
+}
+
+/******************************************************************************
+function: Draw the columns recorded since the last update
+parameter:
+    ctx   : Paint context to draw on
+    Chart : Widget
+info:
+    CHART_SWEEP draws the new columns in place and clears the column after
+    them, the changed rectangle is only the new columns wide.
+    CHART_SCROLL moves the chart left in the image with Paint_ScrollWindow
+    and draws the new columns on the right; the whole chart changes on the
+    panel. The chart is redrawn completely when it is invalidated or when
+    auto scale changes the range. Returns the rectangle that changed.
+******************************************************************************/
+PAINT_RECT Widget_ChartUpdate_ctx(PAINT *ctx, WIDGET_CHART *Chart)
+{
+    PAINT_RECT Rect = {0, 0, 0, 0};
+    UDOUBLE n, New = Chart->Total - Chart->Shown;
+    UWORD X;
+
+    Chart->Rescaled = Widget_ChartScale(Chart);
+    if(!Chart->Drawn || Chart->Rescaled || New >= Chart->Width) {
+        for(X = 0; X < Chart->Width; X++) {
+            if(Chart->Mode == CHART_SWEEP) {
+                //ring slot X holds the newest column drawn at X
+                if(X >= Chart->Total || X == Chart->Total % Chart->Width)
+                    Widget_ChartColumn(ctx, Chart, X, NULL);
+                else
+                    Widget_ChartColumn(ctx, Chart, X, &Chart->Ring[X]);
+            } else if(Chart->Total + X >= Chart->Width) {
+                n = Chart->Total + X - Chart->Width;
+                Widget_ChartColumn(ctx, Chart, X, &Chart->Ring[n % Chart->Width]);
+            } else {
+                Widget_ChartColumn(ctx, Chart, X, NULL);
+            }
+        }
+        Chart->Drawn = 1;
+        Chart->Shown = Chart->Total;
+        Rect.Xstart = Chart->Xstart;
+        Rect.Ystart = Chart->Ystart;
+        Rect.Xend = Chart->Xstart + Chart->Width;
+        Rect.Yend = Chart->Ystart + Chart->Height;
+        return Rect;
+    }
+    if(New == 0)
+        return Rect;
+
+    Rect.Ystart = Chart->Ystart;
+    Rect.Yend = Chart->Ystart + Chart->Height;
+    if(Chart->Mode == CHART_SCROLL) {
+        Paint_ScrollWindow_ctx(ctx, Chart->Xstart, Chart->Ystart, Chart->Xstart + Chart->Width,
+                           Chart->Ystart + Chart->Height, -(int)New);
+        for(n = Chart->Shown; n < Chart->Total; n++)
+            Widget_ChartColumn(ctx, Chart, Chart->Width - (Chart->Total - n), &Chart->Ring[n % Chart->Width]);
+        Rect.Xstart = Chart->Xstart;
+        Rect.Xend = Chart->Xstart + Chart->Width;
+    } else {
+        for(n = Chart->Shown; n < Chart->Total; n++) {
+            X = n % Chart->Width;
+            Widget_ChartColumn(ctx, Chart, X, &Chart->Ring[X]);
+            Paint_RectUnion(&Rect, (PAINT_RECT){Chart->Xstart + X, Rect.Ystart, Chart->Xstart + X + 1, Rect.Yend});
+        }
+        //gap in front of the newest column
+        X = Chart->Total % Chart->Width;
+        Widget_ChartColumn(ctx, Chart, X, NULL);
+        Paint_RectUnion(&Rect, (PAINT_RECT){Chart->Xstart + X, Rect.Ystart, Chart->Xstart + X + 1, Rect.Yend});
+    }
+    Chart->Shown = Chart->Total;
+    return Rect;
+}
+
+/******************************************************************************
+function: Widget updates drawing on the global Paint context
+******************************************************************************/
+PAINT_RECT Widget_BarUpdate(WIDGET_BAR *Bar, int Value)
+{
+    return Widget_BarUpdate_ctx(&Paint, Bar, Value);
+}
+
+PAINT_RECT Widget_GaugeUpdate(WIDGET_GAUGE *Gauge, int Value)
+{
+    return Widget_GaugeUpdate_ctx(&Paint, Gauge, Value);
+}
+
+PAINT_RECT Widget_ChartUpdate(WIDGET_CHART *Chart)
+{
+    return Widget_ChartUpdate_ctx(&Paint, Chart);
+}
@@ -0,0 +1,161 @@
+/*****************************************************************************
+* | File      	:   GUI_Widget.h
+* | Author      :   NASsie
+* | Function    :   Bar, gauge and segmented meter widgets
+* | Info        :
+*                Widgets are driven by a value range and a threshold table.
+*                Fill colours come from a lookup table built once when the
+*                widget is created, and an update only draws the pixels
+*                between the old and the new value.
+*----------------
+* |	This version:   V1.0
+* | Date        :   2026-10-19
+* | Info        :   Basic version
+*
+******************************************************************************/
+#ifndef __GUI_WIDGET_H
+#define __GUI_WIDGET_H
+
+#include "GUI_Paint.h"
+
+#define WIDGET_MAX_LENGTH   320     //longest bar, in pixels
+#define WIDGET_MAX_RADIUS   127     //largest gauge
+
+/**
+ * Threshold table entry. The table is sorted by Value.
+ * WIDGET_FILL_GRADIENT: colour stops, blended in between.
+ * WIDGET_FILL_LEVEL: colour of the whole fill from Value upward.
+**/
+typedef struct {
+    int Value;
+    UWORD Color;
+} WIDGET_THRESHOLD;
+
+typedef enum {
+    WIDGET_FILL_GRADIENT = 0,
+    WIDGET_FILL_LEVEL,
+} WIDGET_FILL;
+
+typedef enum {
+    WIDGET_LEFT_RIGHT = 0,      //bar grows to the right
+    WIDGET_BOTTOM_UP,           //bar grows upward
+} WIDGET_DIRECTION;
+
+/**
+ * Bar and segmented meter
+**/
+typedef struct {
+    UWORD Xstart;
+    UWORD Ystart;
+    UWORD Width;
+    UWORD Height;
+    WIDGET_DIRECTION Direction;
+    int Min;
+    int Max;
+    const WIDGET_THRESHOLD *Threshold;
+    UBYTE Thresholds;
+    WIDGET_FILL Fill;
+    UWORD BackColor;
+    UWORD Segment;              //segment length in pixels, 0 for a solid bar
+    UWORD Gap;                  //gap between segments
+    UWORD Length;               //travel in pixels
+    UWORD Level;                //drawn length in pixels
+    UWORD LevelColor;           //colour of the fill for WIDGET_FILL_LEVEL
+    UBYTE Drawn;
+    UWORD Lut[WIDGET_MAX_LENGTH];
+} WIDGET_BAR;
+
+/**
+ * Arc gauge. Angles are in degrees, clockwise from 12 o'clock.
+**/
+typedef struct {
+    UWORD X_Center;
+    UWORD Y_Center;
+    UWORD Radius;
+    UWORD Thickness;
+    int Start;
+    int Sweep;
+    int Min;
+    int Max;
+    const WIDGET_THRESHOLD *Threshold;
+    UBYTE Thresholds;
+    WIDGET_FILL Fill;
+    UWORD BackColor;
+    UWORD Steps;                //angular resolution of the gauge
+    UWORD Level;                //drawn steps
+    UWORD LevelColor;
+    UBYTE Drawn;
+    UDOUBLE Pixels;
+    UDOUBLE *Map;               //step << 16 | dx << 8 | dy, sorted by step
+    UWORD *Lut;                 //colour for each step
+} WIDGET_GAUGE;
+
+/**
+ * History chart. Samples are collected into columns (Decimate samples per
+ * column, drawn as a min/max envelope with the average on top) and kept in
+ * a ring buffer with one entry per column of the chart.
+**/
+#define CHART_MAX_WIDTH     240
+
+typedef enum {
+    CHART_SCROLL = 0,           //newest column on the right, old columns move left
+    CHART_SWEEP,                //columns written in place, wrapping like a scope
+} CHART_MODE;
+
+typedef struct {
+    int Min;
+    int Max;
+    int Average;
+} CHART_COLUMN;
+
+typedef struct {
+    UWORD Xstart;
+    UWORD Ystart;
+    UWORD Width;
+    UWORD Height;
+    CHART_MODE Mode;
+    int Min;                    //current scale
+    int Max;
+    UBYTE AutoScale;
+    UWORD Decimate;
+    UWORD Color;
+    UWORD EnvelopeColor;
+    UWORD BackColor;
+    UBYTE Rescaled;             //scale changed by the last update
+    UBYTE Drawn;
+    UDOUBLE Total;              //columns completed since init
+    UDOUBLE Shown;              //columns drawn so far
+    UWORD Collected;            //samples in the column being collected
+    CHART_COLUMN Next;          //column being collected
+    CHART_COLUMN Ring[CHART_MAX_WIDTH];
+} WIDGET_CHART;
+
+void Widget_BarInit(WIDGET_BAR *Bar, UWORD Xstart, UWORD Ystart, UWORD Width, UWORD Height,
+                    WIDGET_DIRECTION Direction, int Min, int Max,
+                    const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, UWORD BackColor);
+void Widget_MeterInit(WIDGET_BAR *Bar, UWORD Xstart, UWORD Ystart, UWORD Width, UWORD Height,
+                      WIDGET_DIRECTION Direction, int Min, int Max, UWORD Segments, UWORD Gap,
+                      const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, UWORD BackColor);
+PAINT_RECT Widget_BarUpdate(WIDGET_BAR *Bar, int Value);
+PAINT_RECT Widget_BarUpdate_ctx(PAINT *ctx, WIDGET_BAR *Bar, int Value);
+void Widget_BarInvalidate(WIDGET_BAR *Bar);
+
+UBYTE Widget_GaugeInit(WIDGET_GAUGE *Gauge, UWORD X_Center, UWORD Y_Center, UWORD Radius, UWORD Thickness,
+                       int Start, int Sweep, int Min, int Max,
+                       const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, UWORD BackColor);
+PAINT_RECT Widget_GaugeUpdate(WIDGET_GAUGE *Gauge, int Value);
+PAINT_RECT Widget_GaugeUpdate_ctx(PAINT *ctx, WIDGET_GAUGE *Gauge, int Value);
+void Widget_GaugeInvalidate(WIDGET_GAUGE *Gauge);
+void Widget_GaugeFree(WIDGET_GAUGE *Gauge);
+
+void Widget_ChartInit(WIDGET_CHART *Chart, UWORD Xstart, UWORD Ystart, UWORD Width, UWORD Height,
+                      CHART_MODE Mode, int Min, int Max, UBYTE AutoScale, UWORD Decimate,
+                      UWORD Color, UWORD EnvelopeColor, UWORD BackColor);
+void Widget_ChartPush(WIDGET_CHART *Chart, int Value);
+PAINT_RECT Widget_ChartUpdate(WIDGET_CHART *Chart);
+PAINT_RECT Widget_ChartUpdate_ctx(PAINT *ctx, WIDGET_CHART *Chart);
+void Widget_ChartInvalidate(WIDGET_CHART *Chart);
+
+UWORD Widget_ThresholdColor(const WIDGET_THRESHOLD *Threshold, UBYTE Thresholds, WIDGET_FILL Fill, int Value);
+
+#endif
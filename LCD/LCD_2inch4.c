@@ -273,6 +273,94 @@ void LCD_2IN4_Display(UBYTE *image)
 	}
 }
 
+/******************************************************************************
+function: Show an 8 bit indexed picture
+parameter	:
+		image  : Picture buffer, one palette index per pixel
+		palette: 256 RGB565 colours in panel byte order
+info:
+		The palette is expanded a few lines at a time into a small buffer
+		that is sent in one SPI write (spidev limits a write to 4096 bytes).
+******************************************************************************/
+void LCD_2IN4_Display_Indexed(const UBYTE *image, const UWORD *palette)
+{
+	UWORD line[LCD_2IN4_WIDTH*LCD_2IN4_LINES_PER_WRITE];
+	UDOUBLE i, n = LCD_2IN4_WIDTH*LCD_2IN4_LINES_PER_WRITE;
+	UWORD j;
+
+	LCD_2IN4_SetWindow(0, 0, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT);
+	DEV_Digital_Write(LCD_DC, 1);
+	for(j = 0; j < LCD_2IN4_HEIGHT; j += LCD_2IN4_LINES_PER_WRITE){
+		const UBYTE *src = image + (UDOUBLE)LCD_2IN4_WIDTH*j;
+		//table lookup unrolled by 8, no branches in the loop body
+		for(i = 0; i < n; i += 8){
+			line[i]   = palette[src[i]];
+			line[i+1] = palette[src[i+1]];
+			line[i+2] = palette[src[i+2]];
+			line[i+3] = palette[src[i+3]];
+			line[i+4] = palette[src[i+4]];
+			line[i+5] = palette[src[i+5]];
+			line[i+6] = palette[src[i+6]];
+			line[i+7] = palette[src[i+7]];
+		}
+		DEV_SPI_Write_nByte((UBYTE *)line, n*2);
+	}
+}
+
+/******************************************************************************
+function: Show part of a picture
+parameter	:
+		image : Picture buffer, full screen
+	  Xstart: Start UWORD x coordinate
+	  Ystart:	Start UWORD y coordinate
+	  Xend  :	End UWORD coordinates (exclusive)
+	  Yend  :	End UWORD coordinates (exclusive)
+******************************************************************************/
+void LCD_2IN4_DisplayWindow(UBYTE *image, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
+{
+	UWORD i;
+	if(Xstart >= Xend || Ystart >= Yend)
+		return;
+	LCD_2IN4_SetWindow(Xstart, Ystart, Xend, Yend);
+	DEV_Digital_Write(LCD_DC, 1);
+	for(i = Ystart; i < Yend; i++){
+		DEV_SPI_Write_nByte(image+(LCD_2IN4_WIDTH*i+Xstart)*2,(Xend-Xstart)*2);
+	}
+}
+
+/******************************************************************************
+function: Show part of an 8 bit indexed picture
+parameter	:
+		image  : Picture buffer, full screen, one palette index per pixel
+		palette: 256 RGB565 colours in panel byte order
+	  Xstart: Start UWORD x coordinate
+	  Ystart:	Start UWORD y coordinate
+	  Xend  :	End UWORD coordinates (exclusive)
+	  Yend  :	End UWORD coordinates (exclusive)
+******************************************************************************/
+void LCD_2IN4_DisplayWindow_Indexed(const UBYTE *image, const UWORD *palette, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
+{
+	UWORD line[LCD_2IN4_WIDTH*LCD_2IN4_LINES_PER_WRITE];
+	UWORD i, j, w = Xend - Xstart;
+	UDOUBLE n = 0;
+
+	if(Xstart >= Xend || Ystart >= Yend)
+		return;
+	LCD_2IN4_SetWindow(Xstart, Ystart, Xend, Yend);
+	DEV_Digital_Write(LCD_DC, 1);
+	for(j = Ystart; j < Yend; j++){
+		const UBYTE *src = image + (UDOUBLE)LCD_2IN4_WIDTH*j + Xstart;
+		for(i = 0; i < w; i++)
+			line[n+i] = palette[src[i]];
+		n += w;
+		//flush when the next line would not fit
+		if(n + w > LCD_2IN4_WIDTH*LCD_2IN4_LINES_PER_WRITE || j == Yend-1){
+			DEV_SPI_Write_nByte((UBYTE *)line, n*2);
+			n = 0;
+		}
+	}
+}
+
 /******************************************************************************
 function: Draw a point
 parameter	:
@@ -34,6 +34,7 @@
 
 #define LCD_2IN4_WIDTH   240 //LCD width
 #define LCD_2IN4_HEIGHT  320 //LCD height
+#define LCD_2IN4_LINES_PER_WRITE  8 //lines sent per SPI write, 8*240*2 < 4096
 
 
 #define LCD_2IN4_CS_0	LCD_CS_0	 
@@ -51,6 +52,9 @@
 void LCD_2IN4_Init(void); 
 void LCD_2IN4_Clear(UWORD Color);
 void LCD_2IN4_Display(UBYTE *image);
+void LCD_2IN4_Display_Indexed(const UBYTE *image, const UWORD *palette);
+void LCD_2IN4_DisplayWindow(UBYTE *image, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend);
+void LCD_2IN4_DisplayWindow_Indexed(const UBYTE *image, const UWORD *palette, UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend);
 void LCD_2IN4_DrawPaint(UWORD x, UWORD y, UWORD Color);
 void  Handler_2IN4_LCD(int signo);
 
@@ -27,17 +27,38 @@
 #include <unistd.h>   //sleep
 #include <string.h>
 #include <signal.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
 #include <lgpio.h>
 #include "NASsie_utils.h"
+#include "NASsie_net.h"
+#include "NASsie_smart.h"
+#include "NASsie_fs.h"
+#include "NASsie_disk.h"
+#include "NASsie_block.h"
+#include "NASsie_psi.h"
+#include "NASsie_freq.h"
+#include "NASsie_sensor.h"
 #include "./LCD/DEV_Config.h"
 #include "./LCD/GUI_Paint.h"
 #include "./LCD/GUI_BMP.h"
+#include "./LCD/GUI_Widget.h"
 #include "./LCD/LCD_2inch4.h"
 #include "./pic/NASsie_splash.h"  //splash screen image
 #include "./pic/NASsie_stat.h"    //background for status screen
 #include "./pic/NASsie_temp.h"    //background for temperature screen
 
 #define BUFFER_SIZE 200
+#define STAT_BAR_BACK 0xF7DA    //background colour behind the CPU bars
+#define STAT_FS_BACK  0xFDAD    //background colour behind the storage bars
+#define STAT_NET_BACK 0xB63B    //background colour of the network section
+#define TEMP_BACK     0xE619    //background colour of the drive table
+#define LATENCY_BUDGET 50       //milliseconds from button edge to first pixel
+#define IO_ROWS 7               //devices on the disk I/O screen
+#define FS_ROWS 7               //volumes on the storage screen
+#define SENSOR_ROWS 4           //rows of the drive table on the temperature screen
+#define NVME_FAN_OFFSET 20      //NVMe drives run this much hotter than hard drives
 
 //#define NASSIE_DEBUG
 
@@ -47,44 +68,161 @@
 #define DEBUG_PRINT(fmt, args...)  //do nothing for non-debug build
 #endif
 
+enum state_type {splash, stats, temperature, history, activity, storage, standby};
+
+/* Values shown on the screens, copied from the utility globals once per
+   loop so a screen can be drawn while the next values are being read */
+struct metrics_type {
+	int CPU_load[4];
+	int CPU_busy, CPU_iowait;       //all cores
+	int Used_mem;
+	int Temp_CPU;
+	int Temp_dev_sd[SMART_MAX_DRIVES], Temp_dev_min_sd[SMART_MAX_DRIVES], Temp_dev_max_sd[SMART_MAX_DRIVES];
+	int Spin_dev_sd[SMART_MAX_DRIVES], Stale_dev_sd[SMART_MAX_DRIVES];
+	char Drive_name[SMART_MAX_DRIVES][32];
+	int Drive_count;                //slots in use, some may be empty
+	int Wear_dev_sd[SMART_MAX_DRIVES];      //NVMe percent used, -1 for other drives
+	unsigned long long Media_errors_dev_sd[SMART_MAX_DRIVES];
+	int Used_sdcard, Used_hdds, Used_ssds;
+	int fan;
+	char eth_ip[BUFFER_SIZE], wlan_ip[BUFFER_SIZE];
+	int Rate_eth;                   //kB/s
+	int Thin_used, Cache_hits;      //percent, -1 without thin pools or caches
+	char Md_status[32];             //RAID or drive alert strip, "" if not shown
+	int Md_alert;                   //0 healthy, 1 syncing, 2 degraded or failing
+	int Psi_io;                     //percent of time waiting on I/O
+	int Freq_cur, Freq_max;         //MHz
+	int Throttled;                  //FREQ_* bits, -1 if unknown
+	char Sensor_name[SENSOR_ROWS][16];  //board sensors for the free drive rows
+	int Sensor_temp[SENSOR_ROWS], Sensor_min[SENSOR_ROWS], Sensor_max[SENSOR_ROWS];
+	int Sensor_count;
+	struct disk_rate_type Io_dev[IO_ROWS];
+	int Io_dev_count;
+	struct fs_volume_type Fs_dev[FS_ROWS];  //fullest first
+	int Fs_dev_count;
+};
+
+/* A frame buffer with the widgets drawn in it. One is on the LCD, the other
+   holds the next screen of the button rotation, drawn ahead of time */
+struct screen_type {
+	enum state_type drawn;          //screen in image, standby if none
+	PAINT paint;
+	UBYTE image[LCD_2IN4_WIDTH*LCD_2IN4_HEIGHT];   //8 bit indexed frame buffer
+	WIDGET_BAR cpu_bar[4], temp_bar, fs_bar[3];
+	WIDGET_CHART history_chart[3];  //CPU load, CPU temperature, hottest drive
+	WIDGET_BAR io_bar[IO_ROWS];     //utilisation of each device
+	WIDGET_CHART net_chart;         //eth0 traffic
+	char io_shown[IO_ROWS][32];     //device names in image
+	WIDGET_BAR fs_dev_bar[FS_ROWS]; //storage screen
+	char fs_shown[FS_ROWS][32];     //volume names in image
+	char eth_shown[BUFFER_SIZE], wlan_shown[BUFFER_SIZE]; //IPs in image
+	int iowait_shown, mem_shown, rate_shown; //-1 if not in image
+	int thin_shown, cache_shown;    //-2 if not in image, -1 is shown blank
+	char md_shown[32];              //RAID strip in image, "" if none
+	int md_alert_shown;
+	int psi_shown;                  //-1 if not in image
+	int freq_shown, freq_max_shown, throttle_shown; //-2 if not in image
+};
+
+/* Button edge to first pixel, in nanoseconds */
+struct latency_type {
+	unsigned int presses, hits, late;   //hits: next screen was ready
+	uint64_t last, max, total;
+};
+
 //Support functions in this file
 void NASsie_handler(int signo);
+void NASsie_exit();
 void NASsie_button_left();
 void NASsie_button_right();
-void NASsie_update_LCD_stat();
-void NASsie_update_LCD_temperature();
+enum state_type NASsie_next_state(enum state_type from);
+void NASsie_draw(struct screen_type *screen, enum state_type target, int show);
+void NASsie_draw_stat(struct screen_type *screen, int show);
+void NASsie_draw_temperature(struct screen_type *screen, int show);
+void NASsie_draw_history(struct screen_type *screen, int show);
+void NASsie_draw_activity(struct screen_type *screen, int show);
+void NASsie_draw_storage(struct screen_type *screen, int show);
+void NASsie_show_rect(struct screen_type *screen, PAINT_RECT rect);
+void NASsie_show(struct screen_type *screen);
+void *NASsie_render_thread(void *arg);
+void NASsie_snapshot();
+void NASsie_wake();
+void NASsie_chart_push(int chart, int value);
 void NASsie_fan_update();
+void NASsie_debug_drives();
+void NASsie_init_palette();
+void NASsie_init_widgets(struct screen_type *screen);
+void NASsie_format_size(char *text, int size, unsigned long long bytes);
+int NASsie_hottest_drive();
 void sleep_count(int count);
 
-enum state_type {splash, stats, temperature, standby};
+/* Board sensors shown in the free rows of the drive table: label in the
+   sensor registry (see NASsie_sensor.h) and the name shown. Sensors that
+   are not there are left out. The CM4 has the SoC sensor only: its PMIC
+   has no hwmon driver and the fan is driven without a tachometer */
+const char *sensor_rows[][2] = {
+	{"thermal/cpu-thermal", "cpu"}
+};
+
 enum state_type state;
 int lgpio, status, fan;
-int Temp_dev_max_sd[4], Temp_dev_min_sd[4];
+int Temp_dev_max_sd[SMART_MAX_DRIVES], Temp_dev_min_sd[SMART_MAX_DRIVES];
 unsigned int tick = 0, tick_slow = 0, standby_count = 0;
+unsigned int temp_page = 0;     //page of the drive table, turned with every temperature update
 FILE *log_file;
 time_t curtime;
-char image[320*240*2];
-UWORD *image_p;
+UBYTE image_stat[LCD_2IN4_WIDTH*LCD_2IN4_HEIGHT];    //indexed copy of NASsie_stat
+UBYTE image_temp[LCD_2IN4_WIDTH*LCD_2IN4_HEIGHT];    //indexed copy of NASsie_temp
+PAINT_PALETTE palette;
+struct screen_type screens[2];
+struct screen_type *screen = &screens[0];       //screen on the LCD
+struct screen_type *screen_next = &screens[1];  //next screen, drawn ahead
+struct metrics_type metrics;
+struct latency_type latency;
+int render_pending = 0;
+volatile sig_atomic_t quit = 0;                 //set by NASsie_handler
+pthread_mutex_t screen_lock = PTHREAD_MUTEX_INITIALIZER; //screens, metrics, state and LCD
+pthread_cond_t render_cond = PTHREAD_COND_INITIALIZER;
 
 //Variables from utility functions
 extern int GPIO_Handle;
-extern int Temp_CPU, Temp_dev_sd[4];
+extern int Temp_CPU, Temp_dev_sd[SMART_MAX_DRIVES];
+extern int Spin_dev_sd[SMART_MAX_DRIVES], Stale_dev_sd[SMART_MAX_DRIVES];
+extern char Drive_name[SMART_MAX_DRIVES][32];
+extern int Drive_count;
+extern int Wear_dev_sd[SMART_MAX_DRIVES];
+extern unsigned long long Media_errors_dev_sd[SMART_MAX_DRIVES];
 extern int Used_mem, Used_ssds, Used_hdds, Used_sdcard;
-extern int CPU_load[4], lastSum[4], lastIdle[4]; //one for each CPU core
+extern int Used_swap, Dirty_mem;
+extern int CPU_load[4]; //first four cores
+extern int CPU_busy, CPU_iowait;
+extern struct disk_rate_type Io_dev[DISK_MAX_DEVICES];
+extern int Io_dev_count;
+extern struct fs_volume_type Fs_dev[FS_MAX_VOLUMES];
+extern int Fs_dev_count;
 extern char wlan_ip[BUFFER_SIZE], eth_ip[BUFFER_SIZE];
+extern int Rate_eth, Rate_wlan, Errors_eth, Errors_wlan;
+extern int Thin_used, Cache_hits;
+extern char Md_status[32];
+extern char Smart_status[32];
+extern int Md_alert;
+extern int Psi_cpu, Psi_mem, Psi_io;
+extern int Freq_cur, Freq_max, Throttled;
 extern char Size_mem[BUFFER_SIZE], Size_ssds[BUFFER_SIZE], Size_hdds[BUFFER_SIZE], Size_sdcard[BUFFER_SIZE];
 
 int main()
 {
 	static int userdata20=123;
 	static int userdata21=123;
+	enum state_type shown;
+	struct timespec deadline, now;
+	int wait;
 
 	signal(SIGINT, NASsie_handler); // Exception handling:ctrl + c
 	signal(SIGKILL, NASsie_handler); // Exception handling: kill signal
 	signal(SIGTERM, NASsie_handler); // Exception handling: terminal signal
 
 	state = splash;
-	image_p = (UWORD *)image;
 
 	/* LCD Module Init */
 	if(DEV_ModuleInit() != 0) {
@@ -97,15 +235,20 @@ int main()
 	LCD_SetBacklight(1023);
 	Paint_SetRotate(IMAGE_ROTATE_180 );
 	LCD_2IN4_Display((UBYTE *)NASsie_splash);
+	NASsie_init_palette();
+	NASsie_init_widgets(screen);
+	NASsie_init_widgets(screen_next);
+	screen->drawn = splash;
+	screen_next->drawn = standby;
 
 	/* Configure backback button functions */
 	status = lgGpioClaimInput(lgpio, LG_SET_PULL_DOWN, 20);
-	lgGpioSetDebounce(lgpio, 20, 200000); // set 200 milliseconds of debounce
+	lgGpioSetDebounce(lgpio, 20, 20000); // set 20 milliseconds of debounce
 	lgGpioSetAlertsFunc(lgpio, 20, NASsie_button_right, &userdata20);
 	status = lgGpioClaimAlert(lgpio, LG_SET_PULL_DOWN, LG_RISING_EDGE, 20, -1);
 
 	status = lgGpioClaimInput(lgpio, LG_SET_PULL_DOWN, 21);
-	lgGpioSetDebounce(lgpio, 21, 200000); // set 200 milliseconds of debounce
+	lgGpioSetDebounce(lgpio, 21, 20000); // set 20 milliseconds of debounce
 	lgGpioSetAlertsFunc(lgpio, 21, NASsie_button_left, &userdata21);
 	status = lgGpioClaimAlert(lgpio, LG_SET_PULL_DOWN, LG_RISING_EDGE, 21, -1);
 
@@ -113,44 +256,73 @@ int main()
 	status = lgTxPwm(lgpio, 4, 100.0, 0.0, 0, 0); //100% default, fan signal is inverted
 
 	/* get initial values */
+	Net_Init();
+	Block_Init();
+	Sensor_Init();
 	Update_Temp_CPU();
 	Update_Used_mem();
 	Update_Used_fs();
 	Update_Network();
-	Update_Load_CPU(); //Load will be wrong values but will work next call
+	Update_Network_io(); //rates start with the next call
+	Update_Load_CPU(); //Load is 0 until the next call
+	Update_Disk_io(); //rates start with the next call
+	Update_Dm(); //cache hits start with the next call
+	Update_Md();
+	Psi_Init(); //stalls wake the main loop, see Psi_Wait
+	Update_Psi();
+	Freq_Init();
+	Update_Freq();
 
-	/* get initial drive temperatures */
+	/* start reading drive temperatures, min/max start with the first reading */
 	NASsie_fan_update();
-	Temp_dev_max_sd[0] = Temp_dev_min_sd[0] = Temp_dev_sd[0];
-	Temp_dev_max_sd[1] = Temp_dev_min_sd[1] = Temp_dev_sd[1];
-	Temp_dev_max_sd[2] = Temp_dev_min_sd[2] = Temp_dev_sd[2];
-	Temp_dev_max_sd[3] = Temp_dev_min_sd[3] = Temp_dev_sd[3];
+
+	/* draw the next screen as soon as there are values for it */
+	NASsie_snapshot();
+	lgThreadStart(NASsie_render_thread, NULL);
 
 	/* update screen, based on state:
 		splash: every 30s update slow data
 		stats: update fast data every 1s, slow data every 30s
-		history: update data every 5s, slow data every 30s
+		temperature: update data every 5s, slow data every 30s
+		history: draw new chart columns every 1s
+		activity: update disk I/O rates every 1s
+		storage: update file system usage every 1s
 		standby: update slow data every 30s
+	   The values are read with the screen unlocked, so a button press can
+	   show the next screen while a slow update is running.
 	*/
 	while(1) {
+		if (quit)
+			NASsie_exit();
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_sec++;				//one pass a second, tick and the charts count on it
+		pthread_mutex_lock(&screen_lock);
+		shown = state;
 		if (state != standby) {
 			switch (state) {
 				case stats:						//update every 1s
-					NASsie_update_LCD_stat();
-					Update_Load_CPU();
-					Update_Used_mem();
+					NASsie_draw(screen, stats, 1);
 					DEBUG_PRINT("stat update\n");
 					break;
 				case temperature:					//update every 10s (or 5s?)
 					if(tick > 5) {
-						NASsie_update_LCD_temperature();
-						NASsie_fan_update();
+						temp_page++;				//next drives if there are more than fit
+						NASsie_draw(screen, temperature, 1);
 						tick = 0;
 						DEBUG_PRINT("tickupdate\n");
 					}
 					break;
+				case history:						//charts only draw new columns
+					NASsie_draw(screen, history, 1);
+					break;
+				case activity:						//update every 1s
+					NASsie_draw(screen, activity, 1);
+					break;
+				case storage:						//update every 1s
+					NASsie_draw(screen, storage, 1);
+					break;
 				default:
-					LCD_2IN4_Display((UBYTE *)NASsie_splash);
+					NASsie_draw(screen, splash, 1);
 			}
 			LCD_SetBacklight(1023); //turn backlight on in case in standby
 			if (standby_count > 300) {		//every 5 minutes (300 seconds)
@@ -161,39 +333,117 @@ int main()
 			tick++;
 			standby_count++;
 		}
+		pthread_mutex_unlock(&screen_lock);
+
+		if (shown == stats)
+			Update_Used_mem();
+		if (shown == temperature)
+			Update_Temp_CPU();			//also the board sensors in the drive table
+		if (Update_Disk_io() == DISK_TRUNCATED) {	//also tells Update_Temp_SMART which drives are in use
+			DEBUG_PRINT("/proc/diskstats cut off, raise Disk_buffer\n");
+		}
+		NASsie_fan_update();			//drives are only read when due, see Update_Temp_SMART
+		if (Update_Smart() > 0)			//a drive has more bad sectors or CRC errors
+			NASsie_wake();
+		Update_Network();				//addresses are pushed by netlink, this only copies them
+		Update_Network_io();
+		Update_Used_fs();
+		if (Update_Md() > 0)			//an array lost a device
+			NASsie_wake();
+		Update_Psi();
+		Update_Freq();
+		Update_Load_CPU();				//sampled every second for the history chart
+		NASsie_chart_push(0, CPU_busy);
 		tick_slow++;
 		if(tick_slow > 30) {			//update every 30 seconds
-			NASsie_fan_update();
 			Update_Temp_CPU();
-			Update_Used_fs();
-			Update_Network();
+			NASsie_chart_push(1, Temp_CPU);
+			NASsie_chart_push(2, NASsie_hottest_drive());
+			Update_Dm();
 			tick_slow=0;
 			DEBUG_PRINT("tick_slow update\n");
+			DEBUG_PRINT("mem %d%% swap %d%% dirty+writeback %dMB\n", Used_mem, Used_swap, Dirty_mem);
+			DEBUG_PRINT("eth0 %dkB/s %d errors/s, wlan0 %dkB/s %d errors/s\n", Rate_eth, Errors_eth, Rate_wlan, Errors_wlan);
+			DEBUG_PRINT("thin pool %d%% cache read hits %d%%\n", Thin_used, Cache_hits);
+			DEBUG_PRINT("stalled cpu %d%% memory %d%% io %d%%\n", Psi_cpu, Psi_mem, Psi_io);
+			DEBUG_PRINT("cpu %d of %d MHz, throttled 0x%x\n", Freq_cur, Freq_max, Throttled);
+			NASsie_debug_drives();
+		}
+		NASsie_snapshot();
+		while (1) {						//sleep to the deadline, a stall wakes the screen on the way
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			wait = (deadline.tv_sec - now.tv_sec) * 1000 + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+			if (wait <= 0 || quit) break;
+			if (Psi_Wait(wait) != 0) {
+				DEBUG_PRINT("stall trigger\n");
+				NASsie_wake();
+			}
 		}
-		sleep(1);
 	}
 }
 
 /***************************************************************************
-*SUMMARY: Callback function for left button. When button is pressed change state.
+*SUMMARY: Something needs looking at: come out of standby to the stats
+*  screen, which is drawn on the next pass of the main loop. A screen that
+*  is on is left alone, it only stays on longer.
 *
-*  Parameters: event number, alart array and data pointer
+*  Parameters: none
 *  Return: none
 *  Globals: state, standby_count
 ****************************************************************************/
+void NASsie_wake()
+{
+	pthread_mutex_lock(&screen_lock);
+	if (state == standby)
+		state = stats;
+	standby_count = 0;
+	pthread_mutex_unlock(&screen_lock);
+}
+
+/***************************************************************************
+*SUMMARY: Callback function for left button. When button is pressed change
+*  state and send the new screen to the LCD straight away. The new screen
+*  is normally already drawn by the render thread, if not it is drawn here.
+*  The time from the button edge to the first pixel is kept in latency.
+*
+*  Parameters: event number, alart array and data pointer
+*  Return: none
+*  Globals: state, standby_count, screen, screen_next, latency
+****************************************************************************/
 void NASsie_button_left(int e, lgGpioAlert_p evt, void *data)
 {
-	switch (state) {
-		case splash:
-			state = stats;
-			break;
-		case stats:
-			state = temperature;
-			break;
-		default:
-			state = splash;
-	}
+	struct screen_type *swap;
+	uint64_t edge, first;
+
+	edge = evt[0].report.timestamp;
+	pthread_mutex_lock(&screen_lock);
+	state = NASsie_next_state(state);
 	standby_count = 0; //come out of standby mode when button is pressed
+
+	latency.presses++;
+	if (screen_next->drawn == state) {
+		swap = screen;
+		screen = screen_next;
+		screen_next = swap;
+		latency.hits++;
+	} else
+		NASsie_draw(screen, state, 0);
+
+	first = lguTimestamp();
+	LCD_SetBacklight(1023);
+	NASsie_show(screen);
+
+	latency.last = (first > edge) ? first - edge : 0;
+	latency.total += latency.last;
+	if (latency.last > latency.max) latency.max = latency.last;
+	if (latency.last > LATENCY_BUDGET * 1000000ULL) latency.late++;
+	DEBUG_PRINT("button to first pixel %llu us, frame %llu us\n",
+	            (unsigned long long)latency.last / 1000,
+	            (unsigned long long)(lguTimestamp() - edge) / 1000);
+
+	render_pending = 1;				//draw the screen after this one
+	pthread_cond_signal(&render_cond);
+	pthread_mutex_unlock(&screen_lock);
 }
 
 /***************************************************************************
@@ -208,123 +458,811 @@ void NASsie_button_right(int e, lgGpioAlert_p evt, void *data)
 }
 
 /***************************************************************************
-*SUMMARY: Update LCD with stats screen
+*SUMMARY: Screen shown after the given one when the left button is pressed.
+*
+*  Parameters: from (current screen)
+*  Return: next screen
+*  Globals: none
+****************************************************************************/
+enum state_type NASsie_next_state(enum state_type from)
+{
+	switch (from) {
+		case splash:
+			return(stats);
+		case stats:
+			return(temperature);
+		case temperature:
+			return(history);
+		case history:
+			return(activity);
+		case activity:
+			return(storage);
+		default:
+			return(splash);
+	}
+}
+
+/***************************************************************************
+*SUMMARY: Draw a screen from the metrics snapshot. If the screen already
+*  holds the target only the changes are drawn. With show set the changes
+*  (or the whole screen) are sent to the LCD, otherwise the screen is only
+*  drawn in memory. Called with screen_lock held.
+*
+*  Parameters: screen, target (screen to draw), show
+*  Return: none
+*  Globals: none
+****************************************************************************/
+void NASsie_draw(struct screen_type *screen, enum state_type target, int show)
+{
+	switch (target) {
+		case stats:
+			NASsie_draw_stat(screen, show);
+			break;
+		case temperature:
+			NASsie_draw_temperature(screen, show);
+			break;
+		case history:
+			NASsie_draw_history(screen, show);
+			break;
+		case activity:
+			NASsie_draw_activity(screen, show);
+			break;
+		case storage:
+			NASsie_draw_storage(screen, show);
+			break;
+		default:						//splash is sent from the 16 bit image
+			if (show && screen->drawn != splash)
+				LCD_2IN4_Display((UBYTE *)NASsie_splash);
+			screen->drawn = splash;
+	}
+}
+
+/***************************************************************************
+*SUMMARY: Thread drawing the next screen of the button rotation whenever
+*  there is a new metrics snapshot or the screen changed, so a button press
+*  only has to send it to the LCD.
+*
+*  Parameters: arg (not used)
+*  Return: none, never ends
+*  Globals: screen_next, state, render_pending
+****************************************************************************/
+void *NASsie_render_thread(void *arg)
+{
+	pthread_mutex_lock(&screen_lock);
+	while (1) {
+		while (!render_pending)
+			pthread_cond_wait(&render_cond, &screen_lock);
+		render_pending = 0;
+		NASsie_draw(screen_next, NASsie_next_state(state), 0);
+	}
+	return(NULL);
+}
+
+/***************************************************************************
+*SUMMARY: Copy the utility globals to the metrics used for drawing and
+*  wake the render thread. The eth0 traffic is pushed to the sparkline of
+*  both screens here, and the sensors of sensor_rows are looked up. A
+*  failing drive takes the alert strip unless an array is degraded.
 *
 *  Parameters: none
 *  Return: none
-*  Globals: ...
+*  Globals: metrics, render_pending, screens
+****************************************************************************/
+void NASsie_snapshot()
+{
+	struct sensor_type sensor;
+	int i;
+
+	pthread_mutex_lock(&screen_lock);
+	memcpy(metrics.CPU_load, CPU_load, sizeof(metrics.CPU_load));
+	metrics.CPU_busy = CPU_busy;
+	metrics.CPU_iowait = CPU_iowait;
+	metrics.Used_mem = Used_mem;
+	metrics.Rate_eth = Rate_eth;
+	Widget_ChartPush(&screens[0].net_chart, Rate_eth);
+	Widget_ChartPush(&screens[1].net_chart, Rate_eth);
+	metrics.Io_dev_count = (Io_dev_count < IO_ROWS) ? Io_dev_count : IO_ROWS;
+	memcpy(metrics.Io_dev, Io_dev, metrics.Io_dev_count * sizeof(metrics.Io_dev[0]));
+	metrics.Fs_dev_count = (Fs_dev_count < FS_ROWS) ? Fs_dev_count : FS_ROWS;
+	memcpy(metrics.Fs_dev, Fs_dev, metrics.Fs_dev_count * sizeof(metrics.Fs_dev[0]));
+	metrics.Temp_CPU = Temp_CPU;
+	memcpy(metrics.Temp_dev_sd, Temp_dev_sd, sizeof(metrics.Temp_dev_sd));
+	memcpy(metrics.Temp_dev_min_sd, Temp_dev_min_sd, sizeof(metrics.Temp_dev_min_sd));
+	memcpy(metrics.Temp_dev_max_sd, Temp_dev_max_sd, sizeof(metrics.Temp_dev_max_sd));
+	memcpy(metrics.Spin_dev_sd, Spin_dev_sd, sizeof(metrics.Spin_dev_sd));
+	memcpy(metrics.Stale_dev_sd, Stale_dev_sd, sizeof(metrics.Stale_dev_sd));
+	memcpy(metrics.Drive_name, Drive_name, sizeof(metrics.Drive_name));
+	metrics.Drive_count = Drive_count;
+	memcpy(metrics.Wear_dev_sd, Wear_dev_sd, sizeof(metrics.Wear_dev_sd));
+	memcpy(metrics.Media_errors_dev_sd, Media_errors_dev_sd, sizeof(metrics.Media_errors_dev_sd));
+	metrics.Sensor_count = 0;
+	for (i=0; i<sizeof(sensor_rows)/sizeof(sensor_rows[0]) && metrics.Sensor_count<SENSOR_ROWS; i++) {
+		if (Sensor_Find(sensor_rows[i][0], &sensor) != 0) continue;
+		snprintf(metrics.Sensor_name[metrics.Sensor_count], sizeof(metrics.Sensor_name[0]), "%s", sensor_rows[i][1]);
+		metrics.Sensor_temp[metrics.Sensor_count] = (int)sensor.value;
+		metrics.Sensor_min[metrics.Sensor_count] = (int)sensor.min;
+		metrics.Sensor_max[metrics.Sensor_count] = (int)sensor.max;
+		metrics.Sensor_count++;
+	}
+	metrics.Used_sdcard = Used_sdcard;
+	metrics.Used_hdds = Used_hdds;
+	metrics.Used_ssds = Used_ssds;
+	metrics.Thin_used = Thin_used;
+	metrics.Cache_hits = Cache_hits;
+	strcpy(metrics.Md_status, Md_status);
+	metrics.Md_alert = Md_alert;
+	if (Smart_status[0] != '\0' && Md_alert < 2) {	//a failing drive before a sync
+		strcpy(metrics.Md_status, Smart_status);
+		metrics.Md_alert = 2;
+	}
+	metrics.Psi_io = Psi_io;
+	metrics.Freq_cur = Freq_cur;
+	metrics.Freq_max = Freq_max;
+	metrics.Throttled = Throttled;
+	metrics.fan = fan;
+	strcpy(metrics.eth_ip, eth_ip);
+	strcpy(metrics.wlan_ip, wlan_ip);
+	render_pending = 1;
+	pthread_cond_signal(&render_cond);
+	pthread_mutex_unlock(&screen_lock);
+}
+
+/***************************************************************************
+*SUMMARY: Add a sample to a history chart of both screens.
+*
+*  Parameters: chart (0 CPU load, 1 CPU temperature, 2 hottest drive), value
+*  Return: none
+*  Globals: screens[]
+****************************************************************************/
+void NASsie_chart_push(int chart, int value)
+{
+	pthread_mutex_lock(&screen_lock);
+	Widget_ChartPush(&screens[0].history_chart[chart], value);
+	Widget_ChartPush(&screens[1].history_chart[chart], value);
+	pthread_mutex_unlock(&screen_lock);
+}
+
+/***************************************************************************
+*SUMMARY: Draw the stats screen. The background and all widgets are only
+*  drawn when the screen is entered, after that the bars draw just the
+*  change in value and only the changed windows are sent to the LCD.
+*
+*  Parameters: screen, show (send to the LCD)
+*  Return: none
+*  Globals: metrics, image_stat
 ****************************************************************************/
-void NASsie_update_LCD_stat()
+void NASsie_draw_stat(struct screen_type *screen, int show)
 {
-	int x, color;
+	int i, full, partial;
+	PAINT_RECT rect;
+	PAINT *paint = &screen->paint;
 
-	memcpy((void *)image_p, (const void *) NASsie_stat, sizeof(NASsie_stat));
-	Paint_NewImage(image_p, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 16);
-	Paint_SetRotate(ROTATE_180);
+	full = (screen->drawn != stats);
+	if (full) {
+		memcpy(screen->image, image_stat, sizeof(screen->image));
+		Paint_NewImage_ctx(paint, (UWORD *)screen->image, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+		Paint_SetPalette_ctx(paint, &palette);
+		Paint_SetRotate_ctx(paint, ROTATE_180);
+		for (i=0; i<4; i++) Widget_BarInvalidate(&screen->cpu_bar[i]);
+		for (i=0; i<3; i++) Widget_BarInvalidate(&screen->fs_bar[i]);
+		Widget_BarInvalidate(&screen->temp_bar);
+		screen->eth_shown[0] = screen->wlan_shown[0] = '\0';
+		screen->iowait_shown = screen->mem_shown = screen->rate_shown = -1;
+		screen->thin_shown = screen->cache_shown = -2;
+		screen->md_shown[0] = '\0';
+		screen->md_alert_shown = 0;
+		screen->psi_shown = -1;
+		screen->freq_shown = screen->freq_max_shown = screen->throttle_shown = -2;
+		Widget_ChartInvalidate(&screen->net_chart);
+	}
+	partial = show && !full;	//a full redraw is sent at the end
 
 //	CPU Load
-	x = CPU_load[0];
-	x = (x*150)/100;
-	if (x<0) x = 0;
-	if (x>150) x = 150;
-	Paint_DrawRectangle(65, 70, 65+x, 82, BLUE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
-	x = CPU_load[1];
-	x = (x*150)/100;
-	Paint_DrawRectangle(65, 84, 65+x, 96, GRAY, DOT_PIXEL_1X1, DRAW_FILL_FULL);
-	x = CPU_load[2];
-	x = (x*150)/100;
-	Paint_DrawRectangle(65, 98, 65+x, 110, BRED, DOT_PIXEL_1X1, DRAW_FILL_FULL);
-	x = CPU_load[3];
-	x = (x*150)/100;
-	Paint_DrawRectangle(65, 112, 65+x, 124, BROWN, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+	for (i=0; i<4; i++) {
+		rect = Widget_BarUpdate_ctx(paint, &screen->cpu_bar[i], metrics.CPU_load[i]);
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//	CPU waiting on I/O, next to the title
+	if (metrics.CPU_iowait != screen->iowait_shown) {
+		char text[16];
+		snprintf(text, sizeof(text), "io %d%%", metrics.CPU_iowait);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 168, 36, 226, 48);
+		Paint_DrawString_EN_ctx(paint, 168, 36, text, &Font12, WHITE, BLACK);
+		screen->iowait_shown = metrics.CPU_iowait;
+		rect.Xstart = 168; rect.Ystart = 36; rect.Xend = 226; rect.Yend = 48;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//	Memory in use, on the other side of the title
+	if (metrics.Used_mem != screen->mem_shown) {
+		char text[16];
+		snprintf(text, sizeof(text), "mem %d%%", metrics.Used_mem);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 18, 36, 84, 48);
+		Paint_DrawString_EN_ctx(paint, 18, 36, text, &Font12, WHITE, BLACK);
+		screen->mem_shown = metrics.Used_mem;
+		rect.Xstart = 18; rect.Ystart = 36; rect.Xend = 84; rect.Yend = 48;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//	Software RAID strip over the title while an array syncs or is degraded
+	if (metrics.Md_alert != screen->md_alert_shown || strcmp(metrics.Md_status, screen->md_shown) != 0) {
+		sFONT *font;
+		rect.Xstart = 4; rect.Ystart = 4; rect.Xend = 236; rect.Yend = 28;
+		if (metrics.Md_alert == 0)
+			Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, rect.Xstart, rect.Ystart, rect.Xend, rect.Yend);
+		else {
+			Paint_ClearWindow_ctx(paint, rect.Xstart, rect.Ystart, rect.Xend, rect.Yend,
+			                      (metrics.Md_alert == 2) ? RED : YELLOW);
+			font = (strlen(metrics.Md_status) * Font16.Width <= 232) ? &Font16 : &Font12;	//md127 recover ...
+			Paint_DrawString_EN_ctx(paint, (LCD_2IN4_WIDTH - strlen(metrics.Md_status) * font->Width) / 2,
+			                        16 - font->Height / 2, metrics.Md_status, font, WHITE, BLACK);
+		}
+		strcpy(screen->md_shown, metrics.Md_status);
+		screen->md_alert_shown = metrics.Md_alert;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
 
 // CPU temperature
-	if (Temp_CPU<55) color = GREEN;
-	else if (Temp_CPU<70) color = YELLOW;
-	else color = RED;
-	x = ((Temp_CPU - 20)*150)/60;
-	if (x<0) x = 0;
-	if (x>150) x = 150;
-	Paint_DrawRectangle(65, 142, 65+x, 154, color, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+	rect = Widget_BarUpdate_ctx(paint, &screen->temp_bar, metrics.Temp_CPU);
+	if (partial) NASsie_show_rect(screen, rect);
+
+//	CPU frequency in GHz, current/limit, left of the load scale
+	if (metrics.Freq_cur != screen->freq_shown || metrics.Freq_max != screen->freq_max_shown) {
+		char text[20] = "";
+		if (metrics.Freq_max > 0)
+			snprintf(text, sizeof(text), "%.1f/%.1f", metrics.Freq_cur / 1000.0, metrics.Freq_max / 1000.0);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 14, 52, 64, 64);
+		Paint_DrawString_EN_ctx(paint, 14, 52, text, &Font12, WHITE, BLACK);
+		screen->freq_shown = metrics.Freq_cur;
+		screen->freq_max_shown = metrics.Freq_max;
+		rect.Xstart = 14; rect.Ystart = 52; rect.Xend = 64; rect.Yend = 64;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//	Firmware throttling left of the temperature scale: V under-voltage,
+//	F frequency capped, T throttled, S soft temperature limit. Red while
+//	it is happening, black if it happened since boot.
+	if (metrics.Throttled != screen->throttle_shown) {
+		static const char flag[4] = {'V', 'F', 'T', 'S'};
+		char text[2] = "";
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 14, 126, 50, 138);
+		for (i=0; i<4 && metrics.Throttled > 0; i++) {
+			text[0] = flag[i];
+			if (metrics.Throttled & (1 << i))
+				Paint_DrawString_EN_ctx(paint, 14 + i * Font12.Width, 126, text, &Font12, WHITE, RED);
+			else if (metrics.Throttled & (1 << (i + FREQ_OCCURRED)))
+				Paint_DrawString_EN_ctx(paint, 14 + i * Font12.Width, 126, text, &Font12, WHITE, BLACK);
+		}
+		screen->throttle_shown = metrics.Throttled;
+		rect.Xstart = 14; rect.Ystart = 126; rect.Xend = 50; rect.Yend = 138;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
 
 //STORAGE
-	x = ((Used_sdcard*150)/100);
-	Paint_DrawRectangle(65, 203, 65+x, 215, BLUE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
-	if (Used_hdds != -1) {
-		x = ((Used_hdds*150)/100)+1;   //make sure there is at least 1 bar
-		Paint_DrawRectangle(65, 217, 65+x, 229, BLUE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+	rect = Widget_BarUpdate_ctx(paint, &screen->fs_bar[0], metrics.Used_sdcard);
+	if (partial) NASsie_show_rect(screen, rect);
+	if (metrics.Used_hdds != -1) {
+		rect = Widget_BarUpdate_ctx(paint, &screen->fs_bar[1], metrics.Used_hdds);
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+	if (metrics.Used_ssds != -1) {
+		rect = Widget_BarUpdate_ctx(paint, &screen->fs_bar[2], metrics.Used_ssds);
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//	LVM thin pool space and cache read hits, either side of the title
+	if (metrics.Thin_used != screen->thin_shown) {
+		char text[20] = "";
+		if (metrics.Thin_used >= 0)
+			snprintf(text, sizeof(text), "pool %d%%", metrics.Thin_used);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 14, 168, 80, 180);
+		Paint_DrawString_EN_ctx(paint, 14, 168, text, &Font12, WHITE, BLACK);
+		screen->thin_shown = metrics.Thin_used;
+		rect.Xstart = 14; rect.Ystart = 168; rect.Xend = 80; rect.Yend = 180;
+		if (partial) NASsie_show_rect(screen, rect);
 	}
-	if (Used_ssds != -1) {
-		x = ((Used_ssds*150)/100)+1;
-		Paint_DrawRectangle(65, 231, 65+x, 242, BLUE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+	if (metrics.Cache_hits != screen->cache_shown) {
+		char text[20] = "";
+		if (metrics.Cache_hits >= 0)
+			snprintf(text, sizeof(text), "hit %d%%", metrics.Cache_hits);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 168, 168, 226, 180);
+		Paint_DrawString_EN_ctx(paint, 168, 168, text, &Font12, WHITE, BLACK);
+		screen->cache_shown = metrics.Cache_hits;
+		rect.Xstart = 168; rect.Ystart = 168; rect.Xend = 226; rect.Yend = 180;
+		if (partial) NASsie_show_rect(screen, rect);
 	}
 
-//IP addresses
-	Paint_DrawString_EN(59, 280, (const char *) eth_ip, &Font16, WHITE, BLACK);
-	Paint_DrawString_EN(59, 296, (const char *) wlan_ip, &Font16, WHITE, BLACK);
-	LCD_2IN4_Display((UBYTE *)image);
+//	Time stalled on I/O, left of the scale
+	if (metrics.Psi_io != screen->psi_shown) {
+		char text[16];
+		snprintf(text, sizeof(text), "io %d%%", metrics.Psi_io);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 14, 186, 64, 198);
+		Paint_DrawString_EN_ctx(paint, 14, 186, text, &Font12, WHITE, BLACK);
+		screen->psi_shown = metrics.Psi_io;
+		rect.Xstart = 14; rect.Ystart = 186; rect.Xend = 64; rect.Yend = 198;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//IP addresses, redrawn over the background only when they change
+	if (strcmp(metrics.eth_ip, screen->eth_shown) != 0) {
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 59, 280, LCD_2IN4_WIDTH, 296);
+		Paint_DrawString_EN_ctx(paint, 59, 280, (const char *) metrics.eth_ip, &Font16, WHITE, BLACK);
+		strcpy(screen->eth_shown, metrics.eth_ip);
+		rect.Xstart = 59; rect.Ystart = 280; rect.Xend = LCD_2IN4_WIDTH; rect.Yend = 296;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+	if (strcmp(metrics.wlan_ip, screen->wlan_shown) != 0) {
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 59, 296, LCD_2IN4_WIDTH, 312);
+		Paint_DrawString_EN_ctx(paint, 59, 296, (const char *) metrics.wlan_ip, &Font16, WHITE, BLACK);
+		strcpy(screen->wlan_shown, metrics.wlan_ip);
+		rect.Xstart = 59; rect.Ystart = 296; rect.Xend = LCD_2IN4_WIDTH; rect.Yend = 312;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+//eth0 traffic, either side of the title
+	rect = Widget_ChartUpdate_ctx(paint, &screen->net_chart);
+	if (partial) NASsie_show_rect(screen, rect);
+	if (metrics.Rate_eth != screen->rate_shown) {
+		char text[16];
+		if (metrics.Rate_eth >= 1000)
+			snprintf(text, sizeof(text), "%.1fMB/s", metrics.Rate_eth / 1000.0);
+		else
+			snprintf(text, sizeof(text), "%dkB/s", metrics.Rate_eth);
+		Paint_RestoreWindow_ctx(paint, (UWORD *)image_stat, 14, 260, 78, 272);
+		Paint_DrawString_EN_ctx(paint, 14, 260, text, &Font12, WHITE, BLACK);
+		screen->rate_shown = metrics.Rate_eth;
+		rect.Xstart = 14; rect.Ystart = 260; rect.Xend = 78; rect.Yend = 272;
+		if (partial) NASsie_show_rect(screen, rect);
+	}
+
+	screen->drawn = stats;
+	if (full && show != 0)
+		NASsie_show(screen);
 }
 
 /***************************************************************************
-*SUMMARY: Update LCD with temperature screen
+*SUMMARY: Draw the history screen. Samples are pushed to the charts by the
+*  main loop whatever screen is shown; here the charts draw the columns
+*  added since the last call. The charts sweep like a scope so only the new
+*  columns are sent to the LCD, unless a chart changed its scale.
 *
-*  Parameters: none
+*  Parameters: screen, show (send to the LCD)
 *  Return: none
-*  Globals: Temp_dev_sd[],Temp_dev_min_sd[],Temp_dev_max_sd[],fan
+*  Globals: none
+****************************************************************************/
+void NASsie_draw_history(struct screen_type *screen, int show)
+{
+	const char *title[3] = {"CPU load %", "CPU temp C", "Drive temp C"};
+	char scale[8];
+	int i, full;
+	PAINT_RECT rect;
+	PAINT *paint = &screen->paint;
+	WIDGET_CHART *chart;
+
+	full = (screen->drawn != history);
+	if (full) {
+		Paint_NewImage_ctx(paint, (UWORD *)screen->image, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+		Paint_SetPalette_ctx(paint, &palette);
+		Paint_SetRotate_ctx(paint, ROTATE_180);
+		Paint_Clear_ctx(paint, WHITE);
+		for (i=0; i<3; i++) {
+			Paint_DrawString_EN_ctx(paint, 30, screen->history_chart[i].Ystart - 18, title[i], &Font16, WHITE, BLACK);
+			Widget_ChartInvalidate(&screen->history_chart[i]);
+		}
+	}
+
+	for (i=0; i<3; i++) {
+		chart = &screen->history_chart[i];
+		rect = Widget_ChartUpdate_ctx(paint, chart);
+		if (show && !full) NASsie_show_rect(screen, rect);
+		if (full || chart->Rescaled) {		//scale to the left of the chart
+			Paint_ClearWindow_ctx(paint, 0, chart->Ystart, chart->Xstart - 1, chart->Ystart + chart->Height, WHITE);
+			sprintf(scale, "%3d", chart->Max);
+			Paint_DrawString_EN_ctx(paint, 2, chart->Ystart, scale, &Font12, WHITE, BLACK);
+			sprintf(scale, "%3d", chart->Min);
+			Paint_DrawString_EN_ctx(paint, 2, chart->Ystart + chart->Height - 12, scale, &Font12, WHITE, BLACK);
+			rect.Xstart = 0; rect.Ystart = chart->Ystart;
+			rect.Xend = chart->Xstart - 1; rect.Yend = chart->Ystart + chart->Height;
+			if (show && !full) NASsie_show_rect(screen, rect);
+		}
+	}
+
+	screen->drawn = history;
+	if (show && full)
+		NASsie_show(screen);
+}
+
+/***************************************************************************
+*SUMMARY: Draw the disk I/O screen: for each disk, volume and the SD card
+*  a utilisation bar and the read and write rates, IOPS and average time a
+*  request took. A row is cleared and drawn again only when its device
+*  changed, the text under it is redrawn every second.
+*
+*  Parameters: screen, show (send to the LCD)
+*  Return: none
+*  Globals: metrics
 ****************************************************************************/
-void NASsie_update_LCD_temperature()
+void NASsie_draw_activity(struct screen_type *screen, int show)
 {
-	memcpy((void *)image_p, (const void *) NASsie_temp, sizeof(NASsie_temp));
-	Paint_NewImage(image_p, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 16);
-	Paint_SetRotate(ROTATE_180);
-
-	//sda
-	Paint_DrawNum(90, 115, Temp_dev_min_sd[0], &Font20, WHITE, BLACK);
-	Paint_DrawNum(140, 115, Temp_dev_sd[0], &Font20, WHITE, BLACK);
-	Paint_DrawNum(190, 115, Temp_dev_max_sd[0], &Font20, WHITE, BLACK);
-
-	//sdb
-	Paint_DrawNum(90, 141, Temp_dev_min_sd[1], &Font20, WHITE, BLACK);
-	Paint_DrawNum(140, 141, Temp_dev_sd[1], &Font20, WHITE, BLACK);
-	Paint_DrawNum(190, 141, Temp_dev_max_sd[1], &Font20, WHITE, BLACK);
-
-	//sdc
-	Paint_DrawNum(90, 169, Temp_dev_min_sd[2], &Font20, WHITE, BLACK);
-	Paint_DrawNum(140, 169, Temp_dev_sd[2], &Font20, WHITE, BLACK);
-	Paint_DrawNum(190, 169, Temp_dev_max_sd[2], &Font20, WHITE, BLACK);
-
-	//sdd
-	Paint_DrawNum(90, 196, Temp_dev_min_sd[3], &Font20, WHITE, BLACK);
-	Paint_DrawNum(140, 196, Temp_dev_sd[3], &Font20, WHITE, BLACK);
-	Paint_DrawNum(190, 196, Temp_dev_max_sd[3], &Font20, WHITE, BLACK);
+	char text[40];
+	const char *name;
+	int i, y, full;
+	PAINT_RECT rect;
+	PAINT *paint = &screen->paint;
+	struct disk_rate_type *dev;
+
+	full = (screen->drawn != activity);
+	if (full) {
+		Paint_NewImage_ctx(paint, (UWORD *)screen->image, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+		Paint_SetPalette_ctx(paint, &palette);
+		Paint_SetRotate_ctx(paint, ROTATE_180);
+		Paint_Clear_ctx(paint, WHITE);
+		Paint_DrawString_EN_ctx(paint, 64, 4, "Disk I/O", &Font20, WHITE, BLACK);
+		for (i=0; i<IO_ROWS; i++)
+			screen->io_shown[i][0] = '\0';
+	}
+
+	for (i=0; i<IO_ROWS; i++) {
+		y = 30 + 41*i;
+		dev = &metrics.Io_dev[i];
+		name = (i < metrics.Io_dev_count) ? dev->name : "";
+		if (strcmp(name, screen->io_shown[i]) != 0) {	//device added or removed
+			Paint_ClearWindow_ctx(paint, 0, y, LCD_2IN4_WIDTH, y + 41, WHITE);
+			if (name[0] != '\0')
+				Paint_DrawString_EN_ctx(paint, 4, y, name, &Font16, WHITE, BLACK);
+			Widget_BarInvalidate(&screen->io_bar[i]);
+			strcpy(screen->io_shown[i], name);
+			rect.Xstart = 0; rect.Ystart = y; rect.Xend = LCD_2IN4_WIDTH; rect.Yend = y + 41;
+			if (show && !full) NASsie_show_rect(screen, rect);
+		}
+		if (name[0] == '\0') continue;
+
+		rect = Widget_BarUpdate_ctx(paint, &screen->io_bar[i], (int)(dev->util + 0.5));
+		if (show && !full) NASsie_show_rect(screen, rect);
+
+		Paint_ClearWindow_ctx(paint, 0, y + 17, LCD_2IN4_WIDTH, y + 41, WHITE);
+		snprintf(text, sizeof(text), "R %6.1f MB/s %5.0f IOPS %5.1f ms", dev->read_mbs, dev->read_iops, dev->read_await);
+		Paint_DrawString_EN_ctx(paint, 4, y + 17, text, &Font12, WHITE, BLACK);
+		snprintf(text, sizeof(text), "W %6.1f MB/s %5.0f IOPS %5.1f ms", dev->write_mbs, dev->write_iops, dev->write_await);
+		Paint_DrawString_EN_ctx(paint, 4, y + 29, text, &Font12, WHITE, BLACK);
+		rect.Xstart = 0; rect.Ystart = y + 17; rect.Xend = LCD_2IN4_WIDTH; rect.Yend = y + 41;
+		if (show && !full) NASsie_show_rect(screen, rect);
+	}
+
+	screen->drawn = activity;
+	if (show && full)
+		NASsie_show(screen);
+}
+
+/***************************************************************************
+*SUMMARY: Draw the storage screen: the fullest volumes, each with its name,
+*  a bar of the space used and the sizes and mount point under it. The
+*  rows follow the order of the volumes, a row is cleared and drawn again
+*  when another volume moves into it.
+*
+*  Parameters: screen, show (send to the LCD)
+*  Return: none
+*  Globals: metrics
+****************************************************************************/
+void NASsie_draw_storage(struct screen_type *screen, int show)
+{
+	char text[64], used[12], total[12], avail[12];
+	const char *name;
+	int i, y, full;
+	PAINT_RECT rect;
+	PAINT *paint = &screen->paint;
+	struct fs_volume_type *vol;
+
+	full = (screen->drawn != storage);
+	if (full) {
+		Paint_NewImage_ctx(paint, (UWORD *)screen->image, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+		Paint_SetPalette_ctx(paint, &palette);
+		Paint_SetRotate_ctx(paint, ROTATE_180);
+		Paint_Clear_ctx(paint, WHITE);
+		Paint_DrawString_EN_ctx(paint, 71, 4, "Storage", &Font20, WHITE, BLACK);
+		for (i=0; i<FS_ROWS; i++)
+			screen->fs_shown[i][0] = '\0';
+	}
+
+	for (i=0; i<FS_ROWS; i++) {
+		y = 30 + 41*i;
+		vol = &metrics.Fs_dev[i];
+		name = (i < metrics.Fs_dev_count) ? vol->name : "";
+		if (strcmp(name, screen->fs_shown[i]) != 0) {	//volume mounted, unmounted or moved
+			Paint_ClearWindow_ctx(paint, 0, y, LCD_2IN4_WIDTH, y + 41, WHITE);
+			if (name[0] != '\0') {
+				snprintf(text, sizeof(text), "%.7s", name);
+				Paint_DrawString_EN_ctx(paint, 4, y, text, &Font16, WHITE, BLACK);
+			}
+			Widget_BarInvalidate(&screen->fs_dev_bar[i]);
+			strcpy(screen->fs_shown[i], name);
+			rect.Xstart = 0; rect.Ystart = y; rect.Xend = LCD_2IN4_WIDTH; rect.Yend = y + 41;
+			if (show && !full) NASsie_show_rect(screen, rect);
+		}
+		if (name[0] == '\0') continue;
+
+		rect = Widget_BarUpdate_ctx(paint, &screen->fs_dev_bar[i], vol->usage.percent);
+		if (show && !full) NASsie_show_rect(screen, rect);
+
+		Paint_ClearWindow_ctx(paint, 0, y + 17, LCD_2IN4_WIDTH, y + 41, WHITE);
+		NASsie_format_size(used, sizeof(used), vol->usage.used);
+		NASsie_format_size(total, sizeof(total), vol->usage.total);
+		NASsie_format_size(avail, sizeof(avail), vol->usage.avail);
+		snprintf(text, sizeof(text), "%3d%% %s of %s, %s free", vol->usage.percent, used, total, avail);
+		Paint_DrawString_EN_ctx(paint, 4, y + 17, text, &Font12, WHITE, BLACK);
+		snprintf(text, sizeof(text), "%.33s", vol->mount);
+		Paint_DrawString_EN_ctx(paint, 4, y + 29, text, &Font12, WHITE, GRAY);
+		rect.Xstart = 0; rect.Ystart = y + 17; rect.Xend = LCD_2IN4_WIDTH; rect.Yend = y + 41;
+		if (show && !full) NASsie_show_rect(screen, rect);
+	}
+
+	screen->drawn = storage;
+	if (show && full)
+		NASsie_show(screen);
+}
+
+/***************************************************************************
+*SUMMARY: Size in bytes as a short text with a unit, like df -h.
+*
+*  Parameters: text (result), size of text, bytes
+*  Return: none
+*  Globals: none
+****************************************************************************/
+void NASsie_format_size(char *text, int size, unsigned long long bytes)
+{
+	const char *unit = "KMGTP";
+	double value = bytes / 1024.0;
+
+	while (value >= 1000.0 && unit[1] != '\0') {
+		value /= 1024.0;
+		unit++;
+	}
+	snprintf(text, size, (value < 10.0) ? "%.1f%c" : "%.0f%c", value, *unit);
+}
+
+/***************************************************************************
+*SUMMARY: Send part of a screen to the LCD.
+*
+*  Parameters: screen, rect (area in drawing coordinates, may be empty)
+*  Return: none
+*  Globals: palette
+****************************************************************************/
+void NASsie_show_rect(struct screen_type *screen, PAINT_RECT rect)
+{
+	rect = Paint_RectMemory_ctx(&screen->paint, rect);
+	LCD_2IN4_DisplayWindow_Indexed(screen->image, palette.Color, rect.Xstart, rect.Ystart, rect.Xend, rect.Yend);
+}
+
+/***************************************************************************
+*SUMMARY: Send a whole screen to the LCD.
+*
+*  Parameters: screen
+*  Return: none
+*  Globals: palette
+****************************************************************************/
+void NASsie_show(struct screen_type *screen)
+{
+	if (screen->drawn == splash)
+		LCD_2IN4_Display((UBYTE *)NASsie_splash);
+	else
+		LCD_2IN4_Display_Indexed(screen->image, palette.Color);
+}
+
+/***************************************************************************
+*SUMMARY: Draw the temperature screen
+*
+*  Parameters: screen, show (send to the LCD)
+*  Return: none
+*  Globals: metrics, image_temp, temp_page
+****************************************************************************/
+void NASsie_draw_temperature(struct screen_type *screen, int show)
+{
+	const UWORD row[SENSOR_ROWS] = {115, 141, 169, 196};
+	char label[40];
+	PAINT *paint = &screen->paint;
+	int i, d, first, pages, k = 0;
+
+	memcpy(screen->image, image_temp, sizeof(screen->image));
+	Paint_NewImage_ctx(paint, (UWORD *)screen->image, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+	Paint_SetPalette_ctx(paint, &palette);
+	Paint_SetRotate_ctx(paint, ROTATE_180);
+
+	//Four drive slots a page, with more drives the page turns with every
+	//update and its number is shown below the table. The background has
+	//the names sda to sdd, another drive in a row gets its name drawn over
+	//it, an empty row is cleared and shows the next board sensor if there
+	//is one. A dot after the name shows the spin state: filled spinning,
+	//open idle, grey standby. A stale temperature is grey. An NVMe drive
+	//has its longer name in a small font with the wear, or the media
+	//errors in red, below.
+	pages = (metrics.Drive_count + SENSOR_ROWS - 1) / SENSOR_ROWS;
+	if (pages < 1) pages = 1;
+	first = (temp_page % pages) * SENSOR_ROWS;
+	for (i=0; i<SENSOR_ROWS; i++) {
+		d = first + i;
+		snprintf(label, sizeof(label), "sd%c", 'a' + i);
+		if (strcmp(metrics.Drive_name[d], label) != 0) {
+			Paint_ClearWindow_ctx(paint, 16, row[i] - 2, 86, row[i] + 24, TEMP_BACK);
+			if (metrics.Drive_name[d][0] == '\0') {
+				if (k >= metrics.Sensor_count) continue;
+				snprintf(label, sizeof(label), "/%s", metrics.Sensor_name[k]);
+				Paint_DrawString_EN_ctx(paint, 16, row[i] + 2, label, &Font16, WHITE, BLACK);
+				Paint_DrawNum_ctx(paint, 90, row[i], metrics.Sensor_min[k], &Font20, WHITE, BLACK);
+				Paint_DrawNum_ctx(paint, 140, row[i], metrics.Sensor_temp[k], &Font20, WHITE, BLACK);
+				Paint_DrawNum_ctx(paint, 190, row[i], metrics.Sensor_max[k], &Font20, WHITE, BLACK);
+				k++;
+				continue;
+			}
+			snprintf(label, sizeof(label), "/%s", metrics.Drive_name[d]);
+			if (metrics.Wear_dev_sd[d] < 0 && strncmp(metrics.Drive_name[d], "nvme", 4) != 0)
+				Paint_DrawString_EN_ctx(paint, 16, row[i] + 2, label, &Font16, WHITE, BLACK);
+			else {
+				Paint_DrawString_EN_ctx(paint, 16, row[i] - 1, label, &Font12, WHITE, BLACK);
+				if (metrics.Media_errors_dev_sd[d] > 0) {
+					snprintf(label, sizeof(label), "%llu err", metrics.Media_errors_dev_sd[d]);
+					Paint_DrawString_EN_ctx(paint, 16, row[i] + 13, label, &Font8, WHITE, RED);
+				} else if (metrics.Wear_dev_sd[d] >= 0) {
+					snprintf(label, sizeof(label), "%d%% used", metrics.Wear_dev_sd[d]);
+					Paint_DrawString_EN_ctx(paint, 16, row[i] + 13, label, &Font8, WHITE, BLACK);
+				}
+			}
+		}
+		if (metrics.Spin_dev_sd[d] == SMART_POWER_ACTIVE)
+			Paint_DrawCircle_ctx(paint, 74, row[i]+7, 4, GREEN, DOT_PIXEL_1X1, DRAW_FILL_FULL);
+		else if (metrics.Spin_dev_sd[d] == SMART_POWER_IDLE)
+			Paint_DrawCircle_ctx(paint, 74, row[i]+7, 4, GREEN, DOT_PIXEL_1X1, DRAW_FILL_EMPTY);
+		else if (metrics.Spin_dev_sd[d] == SMART_POWER_STANDBY)
+			Paint_DrawCircle_ctx(paint, 74, row[i]+7, 4, GRAY, DOT_PIXEL_1X1, DRAW_FILL_EMPTY);
+		Paint_DrawNum_ctx(paint, 90, row[i], metrics.Temp_dev_min_sd[d], &Font20, WHITE, BLACK);
+		Paint_DrawNum_ctx(paint, 140, row[i], metrics.Temp_dev_sd[d], &Font20, WHITE,
+		                  metrics.Stale_dev_sd[d] ? GRAY : BLACK);
+		Paint_DrawNum_ctx(paint, 190, row[i], metrics.Temp_dev_max_sd[d], &Font20, WHITE, BLACK);
+	}
+	if (pages > 1) {
+		snprintf(label, sizeof(label), "%u/%d", temp_page % pages + 1, pages);
+		Paint_DrawString_EN_ctx(paint, 16, row[SENSOR_ROWS-1] + 26, label, &Font12, WHITE, BLACK);
+	}
 
 	//fan
-	if(fan==0)
-		Paint_DrawString_EN(110, 258, "OFF", &Font24, WHITE, BLACK);
+	if(metrics.fan==0)
+		Paint_DrawString_EN_ctx(paint, 110, 258, "OFF", &Font24, WHITE, BLACK);
 	else
-		Paint_DrawNum(125, 258, fan, &Font24, WHITE, BLACK);
+		Paint_DrawNum_ctx(paint, 125, 258, metrics.fan, &Font24, WHITE, BLACK);
 
-	LCD_2IN4_Display((UBYTE *)image);
+	screen->drawn = temperature;
+	if (show)
+		NASsie_show(screen);
 }
 
 /***************************************************************************
-*SUMMARY: This function updates the fan speed based on the hottest drive
+*SUMMARY: Build the palette for the 8 bit screens and convert the screen
+*  backgrounds to it. The colours drawn by the screen code are added first so
+*  they are exact, the rest of the palette is the most used background colours.
+*  The splash screen is always sent straight from the 16 bit image.
 *
 *  Parameters: none
 *  Return: none
-*  Globals: fan (fan speed in percent)
+*  Globals: palette, image_stat, image_temp
 ****************************************************************************/
-void NASsie_fan_update()
+void NASsie_init_palette()
 {
+	const unsigned char *backgrounds[2] = {(const unsigned char *)NASsie_stat,
+	                                       (const unsigned char *)NASsie_temp};
+	const UWORD colors[] = {WHITE, BLACK, BLUE, GRAY, BRED, BROWN, GREEN, YELLOW, RED,
+	                        GBLUE, BRRED, STAT_BAR_BACK, STAT_FS_BACK, STAT_NET_BACK, TEMP_BACK};
 	int i;
-	Update_Temp_SMART();
+
+	Paint_PaletteInit(&palette);
+	for (i=0; i<sizeof(colors)/sizeof(colors[0]); i++)
+		Paint_PaletteAdd(&palette, colors[i]);
+	Paint_PaletteBuild(&palette, backgrounds, 2, LCD_2IN4_WIDTH*LCD_2IN4_HEIGHT);
+
+	Paint_NewImage((UWORD *)image_stat, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+	Paint_SetPalette(&palette);
+	Paint_ImportImage(backgrounds[0]);
+	Paint_NewImage((UWORD *)image_temp, LCD_2IN4_WIDTH, LCD_2IN4_HEIGHT, 0, WHITE, 8);
+	Paint_SetPalette(&palette);
+	Paint_ImportImage(backgrounds[1]);
+}
+
+/***************************************************************************
+*SUMMARY: Create the widgets of the stats, history and disk I/O screens. Bars are 151 pixels long
+*  to match the old 0 to 150 pixel rectangles. The storage bars start at -1
+*  so there is always at least 1 bar showing.
+*
+*  Parameters: screen
+*  Return: none
+*  Globals: none
+****************************************************************************/
+void NASsie_init_widgets(struct screen_type *screen)
+{
+	static const WIDGET_THRESHOLD cpu_color[4][1] = {{{0, BLUE}}, {{0, GRAY}}, {{0, BRED}}, {{0, BROWN}}};
+	static const WIDGET_THRESHOLD temp_color[3] = {{0, GREEN}, {55, YELLOW}, {70, RED}};
+	static const WIDGET_THRESHOLD fs_color[1] = {{0, BLUE}};
+	static const WIDGET_THRESHOLD io_color[3] = {{0, GREEN}, {50, YELLOW}, {80, RED}};
+	static const WIDGET_THRESHOLD fs_dev_color[3] = {{0, BLUE}, {80, YELLOW}, {90, RED}};
+	const UWORD fs_y[3] = {203, 217, 231}, fs_h[3] = {12, 12, 11};
+	int i;
+
+	for (i=0; i<4; i++)
+		Widget_BarInit(&screen->cpu_bar[i], 65, 70+14*i, 151, 12, WIDGET_LEFT_RIGHT, 0, 100,
+		               cpu_color[i], 1, WIDGET_FILL_LEVEL, STAT_BAR_BACK);
+	Widget_BarInit(&screen->temp_bar, 65, 142, 151, 12, WIDGET_LEFT_RIGHT, 20, 80,
+	               temp_color, 3, WIDGET_FILL_LEVEL, STAT_BAR_BACK);
+	for (i=0; i<3; i++)
+		Widget_BarInit(&screen->fs_bar[i], 65, fs_y[i], 151, fs_h[i], WIDGET_LEFT_RIGHT, -1, 100,
+		               fs_color, 1, WIDGET_FILL_LEVEL, STAT_FS_BACK);
+
+	for (i=0; i<IO_ROWS; i++)
+		Widget_BarInit(&screen->io_bar[i], 90, 32+41*i, 146, 12, WIDGET_LEFT_RIGHT, 0, 100,
+		               io_color, 3, WIDGET_FILL_LEVEL, STAT_BAR_BACK);
+	for (i=0; i<FS_ROWS; i++)
+		Widget_BarInit(&screen->fs_dev_bar[i], 90, 32+41*i, 146, 12, WIDGET_LEFT_RIGHT, 0, 100,
+		               fs_dev_color, 3, WIDGET_FILL_LEVEL, STAT_BAR_BACK);
+
+	Widget_ChartInit(&screen->net_chart, 172, 258, 60, 16, CHART_SCROLL, 0, 100, 1, 1,
+	                 BLUE, GBLUE, STAT_NET_BACK);
+
+	//history: CPU load 5 samples per column (~16 min), temperatures every 30s (~100 min)
+	Widget_ChartInit(&screen->history_chart[0], 30, 40, 200, 60, CHART_SWEEP, 0, 100, 0, 5, BLUE, GBLUE, WHITE);
+	Widget_ChartInit(&screen->history_chart[1], 30, 130, 200, 60, CHART_SWEEP, 30, 80, 1, 1, RED, BRRED, WHITE);
+	Widget_ChartInit(&screen->history_chart[2], 30, 220, 200, 60, CHART_SWEEP, 20, 50, 1, 1, BLACK, GRAY, WHITE);
+}
+
+/***************************************************************************
+*SUMMARY: Temperature of the hottest drive. Drives in standby are cooling
+*  and their last temperature is old, so they are left out.
+*
+*  Parameters: none
+*  Return: temperature in Celcius
+*  Globals: Temp_dev_sd[], Spin_dev_sd[]
+****************************************************************************/
+int NASsie_hottest_drive()
+{
+	int i, hottest = 0;
+
+	for (i=0; i<SMART_MAX_DRIVES; i++)
+		if (Spin_dev_sd[i] != SMART_POWER_STANDBY && Temp_dev_sd[i] > hottest) hottest = Temp_dev_sd[i];
+	return(hottest);
+}
+
+/***************************************************************************
+*SUMMARY: This function updates the fan speed based on the hottest drive.
+*  Drives in standby are not woken up to read them; they are cooling down
+*  so they do not ask for any fan. Min/max only use current readings.
+*  NVMe drives are rated hotter, NVME_FAN_OFFSET is taken off before they
+*  go through the hard drive curve.
+*  Called every second, the PWM is only changed when the speed changes.
+*
+*  Parameters: none
+*  Return: none
+*  Globals: fan (fan speed in percent), Temp_dev_min_sd[], Temp_dev_max_sd[]
+****************************************************************************/
+void NASsie_fan_update()
+{
+	static int fan_set = -1;
+	static char seen[SMART_MAX_DRIVES][32];	//drive min/max belong to
+	int i, temp;
+
+	if (Update_Temp_SMART() == 0 && fan_set >= 0) return;	//no new readings
 
 	fan = 0;
 
-	for (i=0; i<4; i++) {
-		if (Temp_dev_sd[i] < Temp_dev_min_sd[i]) Temp_dev_min_sd[i] = Temp_dev_sd[i];
-		if (Temp_dev_sd[i] > Temp_dev_max_sd[i]) Temp_dev_max_sd[i] = Temp_dev_sd[i];
-		switch(Temp_dev_sd[i]) {
+	for (i=0; i<SMART_MAX_DRIVES; i++) {
+		if (strcmp(seen[i], Drive_name[i]) != 0) {	//drive plugged in or removed
+			strcpy(seen[i], Drive_name[i]);
+			Temp_dev_min_sd[i] = Temp_dev_max_sd[i] = 0;
+		}
+		if (Drive_name[i][0] == '\0') continue;
+		if (!Stale_dev_sd[i]) {
+			if (Temp_dev_sd[i] < Temp_dev_min_sd[i] || Temp_dev_min_sd[i] == 0) Temp_dev_min_sd[i] = Temp_dev_sd[i];
+			if (Temp_dev_sd[i] > Temp_dev_max_sd[i]) Temp_dev_max_sd[i] = Temp_dev_sd[i];
+		}
+		if (Spin_dev_sd[i] == SMART_POWER_STANDBY) continue;	//cooling
+		temp = Temp_dev_sd[i];
+		if (strncmp(Drive_name[i], "nvme", 4) == 0 && temp > NVME_FAN_OFFSET) temp -= NVME_FAN_OFFSET;
+		switch(temp) {
 			case 0 ... 35:				//Ideal temperature range
 				if(fan < 1) fan = 0;
 				break;
@@ -348,25 +1286,85 @@ void NASsie_fan_update()
 		}
 	}
 //	fan=100;  //DEBUG set to 100% while debugging
-	i = lgTxPwm(lgpio, 4, 100.0, (100.0-fan), 0, 0);
-	DEBUG_PRINT("fan %i\n", fan);
+	if (fan != fan_set) {
+		i = lgTxPwm(lgpio, 4, 100.0, (100.0-fan), 0, 0);
+		fan_set = fan;
+		DEBUG_PRINT("fan %i\n", fan);
+	}
+}
+
+/***************************************************************************
+*SUMMARY: Print the probe statistics of each drive in debug builds.
+*
+*  Parameters: none
+*  Return: none
+*  Globals: none
+****************************************************************************/
+void NASsie_debug_drives()
+{
+#if defined(NASSIE_DEBUG)
+	struct smart_drive_type drive[SMART_MAX_DRIVES];
+	int i, drives;
+
+	drives = Smart_Snapshot(drive, SMART_MAX_DRIVES);
+	for (i=0; i<drives; i++)
+		if (drive[i].results > 0)
+			DEBUG_PRINT("%s %u probes, %u errors, %u over %d ms, avg %llu ms max %u ms\n",
+			            drive[i].device, drive[i].results, drive[i].errors, drive[i].timeouts, SMART_DEADLINE,
+			            drive[i].total_ms / drive[i].results, drive[i].max_ms);
+	for (i=0; i<drives; i++)
+		if (drive[i].attributes.valid)
+			DEBUG_PRINT("%s %u reallocated, %u pending, %u uncorrectable, %u CRC errors, %u hours\n",
+			            drive[i].device, drive[i].attributes.reallocated, drive[i].attributes.pending,
+			            drive[i].attributes.uncorrectable, drive[i].attributes.crc_errors,
+			            drive[i].attributes.power_on_hours);
+	for (i=0; i<drives; i++)
+		if (drive[i].nvme && drive[i].health.temperature != 0)
+			DEBUG_PRINT("%s %dC, %d%% used, %d%% spare, %.2f TB written, %llu media errors, warning 0x%02x\n",
+			            drive[i].device, drive[i].health.temperature, drive[i].health.percent_used,
+			            drive[i].health.spare, drive[i].health.data_written * NVME_UNIT_BYTES / 1e12,
+			            drive[i].health.media_errors, drive[i].health.critical_warning);
+#endif
 }
 
 /***************************************************************************
 *SUMMARY:
-*  Signal handler. Shutdown requested so end program cleanly.
+*  Signal handler. Shutdown requested: only sets quit, the main loop ends
+*  the program with NASsie_exit. The LCD is not touched here, another
+*  thread may be in the middle of sending a screen to it.
 *  The signal number (signo) is ignored since the program always ends
+*
+*  Parameters: signo (signal number)
+*  Return: none
+*  Globals: quit
+****************************************************************************/
+void  NASsie_handler(int signo)
+{
+	quit = 1;
+}
+
+/***************************************************************************
+*SUMMARY:
+*  End program cleanly, called from the main loop after a signal. Holds
+*  screen_lock so no screen is being sent to the LCD meanwhile.
+*    -Report button latency
 *    -Clear LCD
 *    -Turn off LCD backlight
 *    -Shutdown LCD/lpgio system
 *    -exit program
 *
-*  Parameters: signo (signal number)
-*  Return: none
-*  Globals: none
+*  Parameters: none
+*  Return: none, does not return
+*  Globals: latency, screen_lock
 ****************************************************************************/
-void  NASsie_handler(int signo)
+void NASsie_exit()
 {
+	pthread_mutex_lock(&screen_lock);
+	if (latency.presses > 0)
+		fprintf(stderr, "NASsie: %u presses, %u ready, button to first pixel avg %llu ms max %llu ms, %u over %d ms\n",
+		        latency.presses, latency.hits,
+		        (unsigned long long)(latency.total / latency.presses / 1000000),
+		        (unsigned long long)(latency.max / 1000000), latency.late, LATENCY_BUDGET);
 	LCD_2IN4_Clear(BLACK);
 	LCD_SetBacklight(0);
 	DEV_ModuleExit();
@@ -0,0 +1,392 @@
+/*************************************************************************
+*                              NASsie_block
+*                       Block devices for NASsie
+*
+*   Keeps a table of the disks, device mapper volumes, SD card and NVMe
+* drives. The table is filled once by scanning /sys/block and then kept up
+* to date by a thread listening to the kernel uevents, so a drive that is
+* plugged in or removed shows up straight away and nothing is rescanned or
+* polled. Callers compare Block_Generation to know when to look again.
+* Partitions, loop, ram and zram devices are left out.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "NASsie_block.h"
+
+#define BLOCK_SECTOR 512                //size in /sys/block is in 512 byte sectors
+
+/* GLOBAL VARIBLES */
+static struct block_device_type Block_table[BLOCK_MAX_DEVICES];
+static int Block_count = 0;
+static unsigned int Block_changes = 0;  //bumped on every change of the table
+static int Block_socket = -1;
+static pthread_mutex_t Block_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int Block_Scan();
+static void *Block_Watch(void *arg);
+
+/***************************************************************************
+*SUMMARY:
+*  Read a short sysfs attribute, without the new line.
+*
+*  Parameters: path, value (result), size of value
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+static int Block_Attribute(const char *path, char *value, int size)
+{
+	int fd, len;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return(1);
+	len = read(fd, value, size - 1);
+	close(fd);
+	if (len < 0) return(1);
+	while (len > 0 && (value[len-1] == '\n' || value[len-1] == ' ')) len--;
+	value[len] = '\0';
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Kind of a device from its name. Loop, ram and zram devices are not
+*  storage worth showing and give -1.
+*
+*  Parameters: name
+*  Return: kind, -1 to leave out
+*  Globals: none
+****************************************************************************/
+static int Block_Kind(const char *name)
+{
+	if (strncmp(name, "loop", 4) == 0 || strncmp(name, "ram", 3) == 0 || strncmp(name, "zram", 4) == 0)
+		return(-1);
+	if (strncmp(name, "sd", 2) == 0) return(BLOCK_SD);
+	if (strncmp(name, "dm-", 3) == 0) return(BLOCK_DM);
+	if (strncmp(name, "mmcblk", 6) == 0) return(BLOCK_MMC);
+	if (strncmp(name, "nvme", 4) == 0) return(BLOCK_NVME);
+	if (strncmp(name, "md", 2) == 0) return(BLOCK_MD);
+	return(BLOCK_OTHER);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Is a device (or the disk a partition is on) spinning. A partition has
+*  no queue directory of its own, its disk is the parent directory.
+*
+*  Parameters: name (e.g. sda or sda1)
+*  Return: 1 if rotational
+*  Globals: none
+****************************************************************************/
+static int Block_Rotational(const char *name)
+{
+	char path[300], value[8];
+
+	snprintf(path, sizeof(path), "/sys/class/block/%s/queue/rotational", name);
+	if (Block_Attribute(path, value, sizeof(value)) != 0) {
+		snprintf(path, sizeof(path), "/sys/class/block/%s/../queue/rotational", name);
+		if (Block_Attribute(path, value, sizeof(value)) != 0) return(0);
+	}
+	return(value[0] == '1');
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Fill in a device from sysfs. Device mapper and md volumes count as
+*  rotational if any device under them is: the HDD volume and the SSD
+*  volume of the NAS are told apart this way.
+*
+*  Parameters: name, dev (result)
+*  Return: error code, 1 if the device is gone or left out
+*  Globals: none
+****************************************************************************/
+static int Block_Read(const char *name, struct block_device_type *dev)
+{
+	char path[300], value[32];
+	DIR *dir;
+	struct dirent *entry;
+	int kind = Block_Kind(name);
+
+	if (kind < 0 || strlen(name) >= sizeof(dev->name)) return(1);
+	memset(dev, 0, sizeof(*dev));
+	strcpy(dev->name, name);
+	dev->kind = kind;
+
+	snprintf(path, sizeof(path), "/sys/block/%s/size", name);
+	if (Block_Attribute(path, value, sizeof(value)) != 0) return(1);
+	dev->size = strtoull(value, NULL, 10) * BLOCK_SECTOR;
+	snprintf(path, sizeof(path), "/sys/block/%s/removable", name);
+	if (Block_Attribute(path, value, sizeof(value)) == 0)
+		dev->removable = (value[0] == '1');
+
+	if (kind == BLOCK_DM || kind == BLOCK_MD) {
+		if (kind == BLOCK_DM) {
+			snprintf(path, sizeof(path), "/sys/block/%s/dm/name", name);
+			Block_Attribute(path, dev->dm_name, sizeof(dev->dm_name));
+		}
+		snprintf(path, sizeof(path), "/sys/block/%s/slaves", name);
+		dir = opendir(path);
+		while (dir != NULL && (entry = readdir(dir)) != NULL)
+			if (entry->d_name[0] != '.' && Block_Rotational(entry->d_name))
+				dev->rotational = 1;
+		if (dir != NULL) closedir(dir);
+	} else
+		dev->rotational = Block_Rotational(name);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Order of the table: by kind, then shorter names first so sdz comes
+*  before sdaa, then by name.
+*
+*  Parameters: a, b (struct block_device_type)
+*  Return: <0, 0 or >0 as for qsort
+*  Globals: none
+****************************************************************************/
+static int Block_Compare(const void *a, const void *b)
+{
+	const struct block_device_type *da = a, *db = b;
+	int la = strlen(da->name), lb = strlen(db->name);
+
+	if (da->kind != db->kind) return(da->kind - db->kind);
+	if (la != lb) return(la - lb);
+	return(strcmp(da->name, db->name));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Open the uevent socket, scan /sys/block and start the thread that keeps
+*  the table up to date. The socket is bound before the scan so no event
+*  can be missed in between.
+*
+*  Parameters: none
+*  Return: error code, 0 when the devices are being watched.
+*  Globals: Block_socket
+****************************************************************************/
+int Block_Init()
+{
+	struct sockaddr_nl sa;
+	pthread_t thread;
+
+	if (Block_socket >= 0) return(0);
+	Block_socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+	if (Block_socket >= 0) {
+		memset(&sa, 0, sizeof(sa));
+		sa.nl_family = AF_NETLINK;
+		sa.nl_groups = 1;			//kernel events, not the ones udev sends on
+		if (bind(Block_socket, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+			close(Block_socket);
+			Block_socket = -1;
+		}
+	}
+
+	Block_Scan();
+	if (Block_socket < 0) return(1);
+	if (pthread_create(&thread, NULL, Block_Watch, NULL) != 0) return(1);
+	pthread_detach(thread);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Scan /sys/block and replace the table.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Block_table, Block_count, Block_changes
+****************************************************************************/
+static int Block_Scan()
+{
+	struct block_device_type table[BLOCK_MAX_DEVICES];
+	DIR *dir;
+	struct dirent *entry;
+	int count = 0;
+
+	dir = opendir("/sys/block");
+	if (dir == NULL) return(1);
+	while ((entry = readdir(dir)) != NULL && count < BLOCK_MAX_DEVICES)
+		if (entry->d_name[0] != '.' && Block_Read(entry->d_name, &table[count]) == 0)
+			count++;
+	closedir(dir);
+	qsort(table, count, sizeof(table[0]), Block_Compare);
+
+	pthread_mutex_lock(&Block_lock);
+	if (count != Block_count || memcmp(table, Block_table, count * sizeof(table[0])) != 0) {
+		memcpy(Block_table, table, count * sizeof(table[0]));
+		Block_count = count;
+		Block_changes++;
+	}
+	pthread_mutex_unlock(&Block_lock);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Apply one uevent to the table. An event is a header like
+*  "add@/devices/.../block/sda" followed by KEY=value strings, each 0
+*  terminated. Only whole disks (DEVTYPE=disk) of the block subsystem are
+*  used. "change" comes for instance when a device mapper volume gets its
+*  table and name.
+*
+*  Parameters: buffer, len
+*  Return: none
+*  Globals: Block_table, Block_count, Block_changes
+****************************************************************************/
+static void Block_Event(const char *buffer, int len)
+{
+	const char *p, *action = NULL, *subsystem = NULL, *devtype = NULL, *devname = NULL;
+	struct block_device_type dev;
+	int i, found = 0;
+
+	for (p = buffer; p < buffer + len; p += strlen(p) + 1) {
+		if (strncmp(p, "ACTION=", 7) == 0) action = p + 7;
+		else if (strncmp(p, "SUBSYSTEM=", 10) == 0) subsystem = p + 10;
+		else if (strncmp(p, "DEVTYPE=", 8) == 0) devtype = p + 8;
+		else if (strncmp(p, "DEVNAME=", 8) == 0) devname = p + 8;
+	}
+	if (action == NULL || subsystem == NULL || devtype == NULL || devname == NULL) return;
+	if (strcmp(subsystem, "block") != 0 || strcmp(devtype, "disk") != 0) return;
+	if (strncmp(devname, "/dev/", 5) == 0) devname += 5;
+
+	if (strcmp(action, "remove") == 0) {
+		pthread_mutex_lock(&Block_lock);
+		for (i=0; i<Block_count; i++) {
+			if (strcmp(Block_table[i].name, devname) == 0) {
+				memmove(&Block_table[i], &Block_table[i+1], (Block_count - i - 1) * sizeof(Block_table[0]));
+				Block_count--;
+				Block_changes++;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&Block_lock);
+	} else if (strcmp(action, "add") == 0 || strcmp(action, "change") == 0) {
+		if (Block_Read(devname, &dev) != 0) return;	//read before taking the lock, sysfs may be slow
+		pthread_mutex_lock(&Block_lock);
+		for (i=0; i<Block_count; i++) {
+			if (strcmp(Block_table[i].name, devname) == 0) {
+				found = 1;
+				if (memcmp(&Block_table[i], &dev, sizeof(dev)) != 0) {
+					Block_table[i] = dev;
+					Block_changes++;
+				}
+				break;
+			}
+		}
+		if (!found && Block_count < BLOCK_MAX_DEVICES) {
+			Block_table[Block_count++] = dev;
+			qsort(Block_table, Block_count, sizeof(Block_table[0]), Block_Compare);
+			Block_changes++;
+		}
+		pthread_mutex_unlock(&Block_lock);
+	}
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Thread waiting for uevents from the kernel. If the socket buffer
+*  overflowed some events are lost, so /sys/block is scanned again.
+*
+*  Parameters: arg (not used)
+*  Return: none, never ends
+*  Globals: Block_socket
+****************************************************************************/
+static void *Block_Watch(void *arg)
+{
+	char buffer[8192];
+	struct sockaddr_nl from;
+	socklen_t fromlen;
+	int len;
+
+	while (1) {
+		fromlen = sizeof(from);
+		len = recvfrom(Block_socket, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&from, &fromlen);
+		if (len < 0) {
+			if (errno == ENOBUFS)
+				Block_Scan();
+			else if (errno != EINTR)
+				sleep(1);
+			continue;
+		}
+		if (from.nl_pid != 0) continue;			//only trust the kernel
+		buffer[len] = '\0';
+		Block_Event(buffer, len);
+	}
+	return(NULL);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the device table, sorted by kind then name.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of entries copied
+*  Globals: none
+****************************************************************************/
+int Block_List(struct block_device_type *list, int max)
+{
+	int count;
+
+	pthread_mutex_lock(&Block_lock);
+	count = (Block_count < max) ? Block_count : max;
+	memcpy(list, Block_table, count * sizeof(list[0]));
+	pthread_mutex_unlock(&Block_lock);
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Find a device by its name.
+*
+*  Parameters: name (e.g. sda or dm-0), dev (result)
+*  Return: 0 if found, 1 if there is no such device
+*  Globals: none
+****************************************************************************/
+int Block_Find(const char *name, struct block_device_type *dev)
+{
+	int i, found = 1;
+
+	pthread_mutex_lock(&Block_lock);
+	for (i=0; i<Block_count; i++) {
+		if (strcmp(Block_table[i].name, name) == 0) {
+			*dev = Block_table[i];
+			found = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&Block_lock);
+	return(found);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Change counter of the table, so callers only look again after a drive
+*  was added, removed or changed.
+*
+*  Parameters: none
+*  Return: counter, bumped on every change
+*  Globals: none
+****************************************************************************/
+unsigned int Block_Generation()
+{
+	unsigned int changes;
+
+	pthread_mutex_lock(&Block_lock);
+	changes = Block_changes;
+	pthread_mutex_unlock(&Block_lock);
+	return(changes);
+}
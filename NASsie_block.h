@@ -0,0 +1,29 @@
+/*************************************************************************
+* Header file for NASsie_block
+*
+* Block devices found in /sys/block and kept up to date by uevents
+*
+*************************************************************************/
+
+#ifndef _NASSIE_BLOCK_H_
+#define _NASSIE_BLOCK_H_
+
+#define BLOCK_MAX_DEVICES 32
+
+enum block_kind_type {BLOCK_OTHER, BLOCK_SD, BLOCK_DM, BLOCK_MMC, BLOCK_NVME, BLOCK_MD};
+
+struct block_device_type {
+	char name[32];                  //sda, dm-0, mmcblk0
+	char dm_name[128];              //device mapper name (e.g. vg-hdds), "" if not dm
+	enum block_kind_type kind;
+	int rotational;                 //spinning disk, for dm and md: on a spinning disk
+	int removable;
+	unsigned long long size;        //bytes
+};
+
+int Block_Init();
+int Block_List(struct block_device_type *list, int max);
+int Block_Find(const char *name, struct block_device_type *dev);
+unsigned int Block_Generation();
+
+#endif
@@ -0,0 +1,204 @@
+/*************************************************************************
+*                               NASsie_cpu
+*                         CPU load for NASsie
+*
+*   Samples /proc/stat for the total and every core. The number of cores is
+* found once at start up, so the same code works on a CM4, a CM5 or a bigger
+* board. Counters are 64 bit and each sample keeps the full breakdown so
+* iowait can be shown apart from busy: on a NAS the CPU is often "busy"
+* waiting on the disks. Not thread safe, used from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "NASsie_cpu.h"
+#include "NASsie_source.h"
+
+/* GLOBAL VARIBLES */
+static int Cpu_cores = 0;               //0 until Cpu_Init
+static struct cpu_times_type *Cpu_last; //previous sample, total first then each core
+static struct cpu_load_type *Cpu_load;
+static int *Cpu_seen;                   //sample number a core was last read
+static int Cpu_samples = 0;
+static char Cpu_buffer[16384];          //cpu lines come first, the rest may be cut
+static struct source_type Cpu_source = SOURCE("/proc/stat", Cpu_buffer);
+
+/***************************************************************************
+*SUMMARY:
+*  Count the cores and allocate the tables. Cores that are offline have no
+*  line in /proc/stat, so the configured count is used and cores come and
+*  go from the sample.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Cpu_cores, Cpu_last, Cpu_load, Cpu_seen
+****************************************************************************/
+int Cpu_Init()
+{
+	long cores;
+
+	if (Cpu_cores > 0) return(0);
+	cores = sysconf(_SC_NPROCESSORS_CONF);
+	if (cores < 1) cores = 1;
+
+	Cpu_last = calloc(cores + 1, sizeof(Cpu_last[0]));
+	Cpu_load = calloc(cores + 1, sizeof(Cpu_load[0]));
+	Cpu_seen = calloc(cores + 1, sizeof(Cpu_seen[0]));
+	if (Cpu_last == NULL || Cpu_load == NULL || Cpu_seen == NULL) {
+		free(Cpu_last); free(Cpu_load); free(Cpu_seen);
+		return(1);
+	}
+	Cpu_cores = cores;
+	return(Cpu_Sample());
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Number of cores found by Cpu_Init.
+*
+*  Parameters: none
+*  Return: cores, 0 before Cpu_Init
+*  Globals: Cpu_cores
+****************************************************************************/
+int Cpu_Count()
+{
+	return(Cpu_cores);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Difference of two counters. iowait is known to go backwards on some
+*  kernels, a counter that did is taken as not moved.
+*
+*  Parameters: now, last
+*  Return: now - last, or 0
+*  Globals: none
+****************************************************************************/
+static unsigned long long Cpu_Delta(unsigned long long now, unsigned long long last)
+{
+	return((now > last) ? now - last : 0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Work out the percentages of one line from the previous sample. Without
+*  time between the samples (first sample, or a core just back online) the
+*  last percentages are kept.
+*
+*  Parameters: now, last (updated), load (updated), first (no usable last)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Cpu_Update(const struct cpu_times_type *now, struct cpu_times_type *last,
+                       struct cpu_load_type *load, int first)
+{
+	unsigned long long user, system, steal, idle, iowait, busy, total;
+
+	user = Cpu_Delta(now->user, last->user) + Cpu_Delta(now->nice, last->nice);
+	system = Cpu_Delta(now->system, last->system) + Cpu_Delta(now->irq, last->irq)
+	         + Cpu_Delta(now->softirq, last->softirq);
+	steal = Cpu_Delta(now->steal, last->steal);
+	idle = Cpu_Delta(now->idle, last->idle);
+	iowait = Cpu_Delta(now->iowait, last->iowait);
+	busy = user + system + steal;
+	total = busy + idle + iowait;
+	*last = *now;
+	if (first || total == 0) return;
+
+	load->user = 100.0 * user / total;
+	load->system = 100.0 * system / total;
+	load->steal = 100.0 * steal / total;
+	load->busy = 100.0 * busy / total;
+	load->iowait = 100.0 * iowait / total;
+	if (load->busy_avg == 0 && load->iowait_avg == 0) {	//first percentages
+		load->busy_avg = load->busy;
+		load->iowait_avg = load->iowait;
+	} else {
+		load->busy_avg += CPU_EWMA * (load->busy - load->busy_avg);
+		load->iowait_avg += CPU_EWMA * (load->iowait - load->iowait_avg);
+	}
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read /proc/stat and update the percentages of the total and each core.
+*  The lines look like
+*    cpu  13277 0 1966 139231 396 0 3 258 0 0
+*    cpu0 3321 0 491 34807 99 0 1 64 0 0
+*  guest time is already counted in user and nice so it is not read.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Cpu_last, Cpu_load, Cpu_seen, Cpu_samples
+****************************************************************************/
+int Cpu_Sample()
+{
+	struct cpu_times_type now;
+	const char *p, *line;
+	int i, first;
+
+	if (Cpu_cores == 0) return(1);
+	if (Source_Read(&Cpu_source) < 0) return(1);
+	Cpu_samples++;
+
+	for (line = Cpu_buffer; (p = Source_Word(line, "cpu")) != NULL; line = Source_Line(p)) {
+		if (*p == ' ')
+			i = 0;				//all cores
+		else
+			i = Source_Unsigned(&p) + 1;
+		if (i > Cpu_cores) continue;
+
+		now.user = Source_Unsigned(&p);
+		now.nice = Source_Unsigned(&p);
+		now.system = Source_Unsigned(&p);
+		now.idle = Source_Unsigned(&p);
+		now.iowait = Source_Unsigned(&p);
+		now.irq = Source_Unsigned(&p);
+		now.softirq = Source_Unsigned(&p);
+		now.steal = Source_Unsigned(&p);
+
+		first = (Cpu_seen[i] == 0 || Cpu_seen[i] != Cpu_samples - 1);
+		Cpu_Update(&now, &Cpu_last[i], &Cpu_load[i], first);
+		Cpu_seen[i] = Cpu_samples;
+	}
+	for (i=0; i<=Cpu_cores; i++)
+		Cpu_load[i].online = (Cpu_seen[i] == Cpu_samples);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Percentages from the last sample.
+*
+*  Parameters: cpu (core number or CPU_TOTAL), load (result)
+*  Return: error code, 1 if there is no such core
+*  Globals: none
+****************************************************************************/
+int Cpu_Load(int cpu, struct cpu_load_type *load)
+{
+	if (cpu < CPU_TOTAL || cpu >= Cpu_cores) return(1);
+	*load = Cpu_load[cpu + 1];
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Counters from the last sample.
+*
+*  Parameters: cpu (core number or CPU_TOTAL), times (result)
+*  Return: error code, 1 if there is no such core
+*  Globals: none
+****************************************************************************/
+int Cpu_Times(int cpu, struct cpu_times_type *times)
+{
+	if (cpu < CPU_TOTAL || cpu >= Cpu_cores) return(1);
+	*times = Cpu_last[cpu + 1];
+	return(0);
+}
@@ -0,0 +1,34 @@
+/*************************************************************************
+* Header file for NASsie_cpu
+*
+* CPU time breakdown from /proc/stat for any number of cores
+*
+*************************************************************************/
+
+#ifndef _NASSIE_CPU_H_
+#define _NASSIE_CPU_H_
+
+#define CPU_TOTAL  -1           //Cpu_Load of all cores together
+#define CPU_EWMA   0.25         //weight of a new sample in the smoothed values
+
+/* Jiffies from one line of /proc/stat, 64 bit so they never wrap */
+struct cpu_times_type {
+	unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+};
+
+/* Percentages over the last sample and smoothed */
+struct cpu_load_type {
+	int online;                     //core seen in the last sample
+	double busy;                    //user, nice, system, irq, softirq and steal
+	double iowait;                  //idle waiting on I/O, not in busy
+	double user, system, steal;
+	double busy_avg, iowait_avg;    //EWMA of busy and iowait
+};
+
+int Cpu_Init();
+int Cpu_Count();
+int Cpu_Sample();
+int Cpu_Load(int cpu, struct cpu_load_type *load);
+int Cpu_Times(int cpu, struct cpu_times_type *times);
+
+#endif
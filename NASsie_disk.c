@@ -0,0 +1,237 @@
+/*************************************************************************
+*                               NASsie_disk
+*                         Disk activity for NASsie
+*
+*   Reads /proc/diskstats once a second in one pass without allocating and
+* works out the rates of the whole disks (sdX, nvmeXnY), device mapper
+* volumes (dm-X) and the SD card (mmcblkX) from the difference with the
+* previous sample. Partitions are left out, their I/O is counted in the
+* disk. Not thread safe, used from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <string.h>
+#include <time.h>
+#include "NASsie_disk.h"
+#include "NASsie_source.h"
+
+#define DISK_SECTOR 512                 //diskstats counts 512 byte sectors whatever the device
+
+/* One device being followed */
+struct disk_device_type {
+	struct disk_rate_type rate;
+	struct disk_stats_type last;
+	int seen;                       //sample number the device was last read
+};
+
+/* GLOBAL VARIBLES */
+static struct disk_device_type Disk_table[DISK_MAX_DEVICES];
+static int Disk_samples = 0;
+static double Disk_last_ms = 0;
+static char Disk_buffer[65536];  //a line is up to ~150 bytes, loop and ram devices included
+static struct source_type Disk_source = SOURCE("/proc/diskstats", Disk_buffer);
+
+/***************************************************************************
+*SUMMARY:
+*  Is this a device to follow: sd followed by letters, dm- or mmcblk
+*  followed by digits, or an NVMe namespace nvme<N>n<M>. This leaves out
+*  partitions (nvme0n1p1), loop and ram devices.
+*
+*  Parameters: name, len
+*  Return: 1 to follow
+*  Globals: none
+****************************************************************************/
+static int Disk_Wanted(const char *name, int len)
+{
+	int i, start, digits;
+
+	if (len >= 6 && strncmp(name, "nvme", 4) == 0) {
+		for (i = 4, digits = 0; i < len && name[i] >= '0' && name[i] <= '9'; i++) digits++;
+		if (digits == 0 || i == len || name[i] != 'n') return(0);
+		for (i++, digits = 0; i < len; i++, digits++)
+			if (name[i] < '0' || name[i] > '9') return(0);
+		return(digits > 0);
+	}
+	if (len >= 3 && strncmp(name, "sd", 2) == 0) {
+		for (i = 2; i < len; i++)
+			if (name[i] < 'a' || name[i] > 'z') return(0);
+		return(1);
+	}
+	if (len >= 4 && strncmp(name, "dm-", 3) == 0)
+		start = 3;
+	else if (len >= 7 && strncmp(name, "mmcblk", 6) == 0)
+		start = 6;
+	else
+		return(0);
+	for (i = start; i < len; i++)
+		if (name[i] < '0' || name[i] > '9') return(0);
+	return(1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Find the table entry of a device, or a free one for a new device.
+*
+*  Parameters: name, len
+*  Return: entry, NULL if the table is full
+*  Globals: Disk_table
+****************************************************************************/
+static struct disk_device_type *Disk_Find(const char *name, int len)
+{
+	struct disk_device_type *slot = NULL;
+	int i;
+
+	for (i=0; i<DISK_MAX_DEVICES; i++) {
+		if (Disk_table[i].seen == 0) {
+			if (slot == NULL) slot = &Disk_table[i];
+		} else if (strncmp(Disk_table[i].rate.name, name, len) == 0 && Disk_table[i].rate.name[len] == '\0')
+			return(&Disk_table[i]);
+	}
+	if (slot != NULL && len < (int)sizeof(slot->rate.name)) {
+		memset(slot, 0, sizeof(*slot));
+		memcpy(slot->rate.name, name, len);
+		return(slot);
+	}
+	return(NULL);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Difference of two counters, 0 if the counter went back (device removed
+*  and added again between samples).
+*
+*  Parameters: now, last
+*  Return: now - last, or 0
+*  Globals: none
+****************************************************************************/
+static double Disk_Delta(unsigned long long now, unsigned long long last)
+{
+	return((now > last) ? (double)(now - last) : 0.0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Work out the rates of a device from its previous counters.
+*
+*  Parameters: rate (result), now, last, ms (time since the last sample)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Disk_Rate(struct disk_rate_type *rate, const struct disk_stats_type *now,
+                      const struct disk_stats_type *last, double ms)
+{
+	double reads, writes;
+
+	reads = Disk_Delta(now->reads, last->reads);
+	writes = Disk_Delta(now->writes, last->writes);
+	rate->read_iops = reads * 1000.0 / ms;
+	rate->write_iops = writes * 1000.0 / ms;
+	rate->read_mbs = Disk_Delta(now->sectors_read, last->sectors_read) * DISK_SECTOR / 1e6 * 1000.0 / ms;
+	rate->write_mbs = Disk_Delta(now->sectors_written, last->sectors_written) * DISK_SECTOR / 1e6 * 1000.0 / ms;
+	rate->read_await = reads ? Disk_Delta(now->read_ms, last->read_ms) / reads : 0.0;
+	rate->write_await = writes ? Disk_Delta(now->write_ms, last->write_ms) / writes : 0.0;
+	rate->util = Disk_Delta(now->io_ms, last->io_ms) * 100.0 / ms;
+	if (rate->util > 100.0) rate->util = 100.0;
+	rate->queue = Disk_Delta(now->queue_ms, last->queue_ms) / ms;
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read /proc/diskstats and update the rates. A line looks like
+*    8 0 sda 2471 1011 183452 1374 5106 3478 300978 15232 0 9088 16607 ...
+*  major, minor, name, then reads, merged, sectors, ms, the same for
+*  writes, in flight, ms doing I/O and weighted ms (time in queue).
+*
+*  Parameters: none
+*  Return: error code, DISK_TRUNCATED if the file did not fit the buffer
+*  Globals: Disk_table, Disk_samples, Disk_last_ms
+****************************************************************************/
+int Disk_Sample()
+{
+	struct disk_device_type *dev;
+	struct disk_stats_type now;
+	struct timespec ts;
+	const char *p, *name;
+	double ms, elapsed;
+	int i, len;
+
+	if (Source_Read(&Disk_source) < 0) return(1);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ms = ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+	elapsed = ms - Disk_last_ms;
+	Disk_last_ms = ms;
+	Disk_samples++;
+
+	for (p = Disk_buffer; *p != '\0'; p = Source_Line(p)) {
+		Source_Unsigned(&p);			//major
+		Source_Unsigned(&p);			//minor
+		name = Source_Token(&p, &len);
+		if (!Disk_Wanted(name, len)) continue;
+		dev = Disk_Find(name, len);
+		if (dev == NULL) continue;
+
+		now.reads = Source_Unsigned(&p);
+		now.reads_merged = Source_Unsigned(&p);
+		now.sectors_read = Source_Unsigned(&p);
+		now.read_ms = Source_Unsigned(&p);
+		now.writes = Source_Unsigned(&p);
+		now.writes_merged = Source_Unsigned(&p);
+		now.sectors_written = Source_Unsigned(&p);
+		now.write_ms = Source_Unsigned(&p);
+		now.in_flight = Source_Unsigned(&p);
+		now.io_ms = Source_Unsigned(&p);
+		now.queue_ms = Source_Unsigned(&p);
+
+		if (dev->seen == Disk_samples - 1 && elapsed > 0)
+			Disk_Rate(&dev->rate, &now, &dev->last, elapsed);
+		dev->last = now;
+		dev->seen = Disk_samples;
+	}
+	for (i=0; i<DISK_MAX_DEVICES; i++)		//free the devices that went away
+		if (Disk_table[i].seen != Disk_samples) Disk_table[i].seen = 0;
+	return(Disk_source.truncated ? DISK_TRUNCATED : 0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Rates of the devices in the last sample, in the order they were found.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of devices copied
+*  Globals: none
+****************************************************************************/
+int Disk_Rates(struct disk_rate_type *list, int max)
+{
+	int i, count = 0;
+
+	for (i=0; i<DISK_MAX_DEVICES && count<max; i++)
+		if (Disk_table[i].seen == Disk_samples && Disk_samples > 0)
+			list[count++] = Disk_table[i].rate;
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Counters of a device in the last sample.
+*
+*  Parameters: name (e.g. sda), stats (result)
+*  Return: error code, 1 if the device was not in the last sample
+*  Globals: none
+****************************************************************************/
+int Disk_Counters(const char *name, struct disk_stats_type *stats)
+{
+	int i;
+
+	for (i=0; i<DISK_MAX_DEVICES; i++) {
+		if (Disk_table[i].seen == Disk_samples && Disk_samples > 0 && strcmp(Disk_table[i].rate.name, name) == 0) {
+			*stats = Disk_table[i].last;
+			return(0);
+		}
+	}
+	return(1);
+}
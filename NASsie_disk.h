@@ -0,0 +1,35 @@
+/*************************************************************************
+* Header file for NASsie_disk
+*
+* Disk throughput, IOPS, latency and utilisation from /proc/diskstats
+*
+*************************************************************************/
+
+#ifndef _NASSIE_DISK_H_
+#define _NASSIE_DISK_H_
+
+#define DISK_MAX_DEVICES 16
+#define DISK_TRUNCATED   2      //Disk_Sample: /proc/diskstats did not fit, devices after the cut are missing
+
+/* Counters of one line of /proc/diskstats */
+struct disk_stats_type {
+	unsigned long long reads, reads_merged, sectors_read, read_ms;
+	unsigned long long writes, writes_merged, sectors_written, write_ms;
+	unsigned long long in_flight, io_ms, queue_ms;
+};
+
+/* Rates over the last sample */
+struct disk_rate_type {
+	char name[32];                  //sda, nvme0n1, dm-0, mmcblk0
+	double read_mbs, write_mbs;     //MB/s
+	double read_iops, write_iops;
+	double read_await, write_await; //average ms a request took
+	double util;                    //percent of the time the device was busy
+	double queue;                   //average requests in flight
+};
+
+int Disk_Sample();
+int Disk_Rates(struct disk_rate_type *list, int max);
+int Disk_Counters(const char *name, struct disk_stats_type *stats);
+
+#endif
@@ -0,0 +1,249 @@
+/*************************************************************************
+*                                NASsie_dm
+*                   LVM thin pools and caches for NASsie
+*
+*   Asks device mapper for the status of each volume with the DM_TABLE_STATUS
+* ioctl on /dev/mapper/control, what lvs shows without starting lvs. The
+* status lines of thin pools, thin volumes and dm-cache are parsed for the
+* pool headroom and the cache hit rates. The volumes come from the block
+* device registry. DM_NOFLUSH_FLAG keeps a thin pool from committing its
+* metadata for every status. Not thread safe, used from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/dm-ioctl.h>
+#include "NASsie_dm.h"
+#include "NASsie_block.h"
+#include "NASsie_source.h"
+
+#define DM_BUFFER 16384                 //ioctl header and the status of all targets
+
+/* GLOBAL VARIBLES */
+static struct dm_volume_type Dm_table[DM_MAX_VOLUMES];
+static int Dm_count = 0;
+static int Dm_control = -1;
+static unsigned long long Dm_buffer[DM_BUFFER / sizeof(unsigned long long)];   //8 byte aligned
+
+/***************************************************************************
+*SUMMARY:
+*  Read a used/total pair like 1050/262144.
+*
+*  Parameters: p (position, moved past the pair), used, total (results)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Dm_Pair(const char **p, unsigned long long *used, unsigned long long *total)
+{
+	*used = Source_Unsigned(p);
+	*total = Source_Unsigned(p);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Hit ratio in percent.
+*
+*  Parameters: hits, misses
+*  Return: percent, -1 if there were none
+*  Globals: none
+****************************************************************************/
+static double Dm_Ratio(unsigned long long hits, unsigned long long misses)
+{
+	if (hits + misses == 0) return(-1.0);
+	return(100.0 * hits / (hits + misses));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Parse the status line of a thin pool:
+*    <transaction> <used>/<total meta> <used>/<total data> <held root>
+*    ro|rw|out_of_data_space [no_]discard_passdown ... needs_check|- ...
+*  or "Fail" / "Error".
+*
+*  Parameters: status, volume (result)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Dm_Thin_pool(const char *status, struct dm_volume_type *volume)
+{
+	const char *p = status;
+
+	if (Source_Word(p, "Fail") != NULL || Source_Word(p, "Error") != NULL) {
+		volume->needs_check = 1;
+		return;
+	}
+	Source_Unsigned(&p);				//transaction id
+	Dm_Pair(&p, &volume->meta_used, &volume->meta_total);
+	Dm_Pair(&p, &volume->data_used, &volume->data_total);
+	volume->read_only = (strstr(p, " ro ") != NULL);
+	volume->out_of_space = (strstr(p, "out_of_data_space") != NULL);
+	volume->needs_check = (strstr(p, "needs_check") != NULL);
+	if (volume->data_total) volume->data_percent = 100.0 * volume->data_used / volume->data_total;
+	if (volume->meta_total) volume->meta_percent = 100.0 * volume->meta_used / volume->meta_total;
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Parse the status line of dm-cache:
+*    <meta block size> <used>/<total meta> <cache block size>
+*    <used>/<total cache> <read hits> <read misses> <write hits>
+*    <write misses> <demotions> <promotions> <dirty> ...
+*
+*  Parameters: status, volume (result)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Dm_Cache(const char *status, struct dm_volume_type *volume)
+{
+	const char *p = status;
+
+	if (Source_Word(p, "Fail") != NULL || Source_Word(p, "Error") != NULL) {
+		volume->needs_check = 1;
+		return;
+	}
+	Source_Unsigned(&p);				//metadata block size
+	Dm_Pair(&p, &volume->meta_used, &volume->meta_total);
+	Source_Unsigned(&p);				//cache block size
+	Dm_Pair(&p, &volume->cache_used, &volume->cache_total);
+	volume->read_hits = Source_Unsigned(&p);
+	volume->read_misses = Source_Unsigned(&p);
+	volume->write_hits = Source_Unsigned(&p);
+	volume->write_misses = Source_Unsigned(&p);
+	volume->demotions = Source_Unsigned(&p);
+	volume->promotions = Source_Unsigned(&p);
+	volume->dirty = Source_Unsigned(&p);
+	volume->needs_check = (strstr(p, "needs_check") != NULL);
+	if (volume->meta_total) volume->meta_percent = 100.0 * volume->meta_used / volume->meta_total;
+	volume->read_hit_ratio = Dm_Ratio(volume->read_hits, volume->read_misses);
+	volume->write_hit_ratio = Dm_Ratio(volume->write_hits, volume->write_misses);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Status of a device mapper volume with DM_TABLE_STATUS. A volume can have
+*  several targets (a linear volume spread over disks); the first thin pool
+*  or cache target decides its kind, thin targets add up.
+*
+*  Parameters: name (device mapper name, e.g. vg-hdds), volume (result)
+*  Return: error code
+*  Globals: Dm_control, Dm_buffer
+****************************************************************************/
+int Dm_Status(const char *name, struct dm_volume_type *volume)
+{
+	struct dm_ioctl *io = (struct dm_ioctl *)Dm_buffer;
+	struct dm_target_spec *spec;
+	const char *status, *end, *p;
+	unsigned int i, offset;
+
+	if (Dm_control < 0) {
+		Dm_control = open("/dev/mapper/control", O_RDWR | O_CLOEXEC);
+		if (Dm_control < 0) return(1);
+	}
+
+	memset(io, 0, sizeof(*io));
+	io->version[0] = DM_VERSION_MAJOR;
+	io->version[1] = 0;
+	io->version[2] = 0;
+	io->data_size = sizeof(Dm_buffer);
+	io->data_start = sizeof(*io);
+	io->flags = DM_NOFLUSH_FLAG;
+	snprintf(io->name, sizeof(io->name), "%s", name);
+	if (ioctl(Dm_control, DM_TABLE_STATUS, io) < 0) return(1);
+	if (io->flags & DM_BUFFER_FULL_FLAG) return(1);
+
+	memset(volume, 0, sizeof(*volume));
+	snprintf(volume->name, sizeof(volume->name), "%s", name);
+	volume->read_hit_ratio = volume->write_hit_ratio = -1.0;
+	volume->read_hit_recent = volume->write_hit_recent = -1.0;
+	end = (const char *)io + io->data_size;
+	offset = io->data_start;
+	for (i=0; i<io->target_count; i++) {
+		spec = (struct dm_target_spec *)((char *)io + offset);
+		status = (const char *)(spec + 1);
+		if (status >= end || memchr(status, '\0', end - status) == NULL) break;
+
+		if (strcmp(spec->target_type, "thin-pool") == 0 && volume->kind == DM_KIND_OTHER) {
+			volume->kind = DM_KIND_THIN_POOL;
+			Dm_Thin_pool(status, volume);
+		} else if (strcmp(spec->target_type, "cache") == 0 && volume->kind == DM_KIND_OTHER) {
+			volume->kind = DM_KIND_CACHE;
+			Dm_Cache(status, volume);
+		} else if (strcmp(spec->target_type, "thin") == 0
+		           && (volume->kind == DM_KIND_OTHER || volume->kind == DM_KIND_THIN)) {
+			volume->kind = DM_KIND_THIN;
+			p = status;
+			if (Source_Word(p, "Fail") == NULL)
+				volume->mapped += Source_Unsigned(&p);
+			volume->size += spec->length;
+		}
+		offset = io->data_start + spec->next;	//next is from the start of the data
+		if (spec->next == 0) break;
+	}
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the status of every device mapper volume in the block device
+*  registry, and the cache hit rates since the last sample.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Dm_table, Dm_count
+****************************************************************************/
+int Dm_Sample()
+{
+	struct block_device_type list[BLOCK_MAX_DEVICES];
+	struct dm_volume_type table[DM_MAX_VOLUMES], *volume, *last;
+	int i, j, n, count = 0;
+
+	n = Block_List(list, BLOCK_MAX_DEVICES);
+	for (i=0; i<n && count<DM_MAX_VOLUMES; i++) {
+		if (list[i].kind != BLOCK_DM || list[i].dm_name[0] == '\0') continue;
+		volume = &table[count];
+		if (Dm_Status(list[i].dm_name, volume) != 0) continue;
+		snprintf(volume->device, sizeof(volume->device), "%s", list[i].name);
+		count++;
+
+		if (volume->kind != DM_KIND_CACHE) continue;
+		for (j=0; j<Dm_count; j++) {
+			last = &Dm_table[j];
+			if (strcmp(last->name, volume->name) != 0 || last->kind != DM_KIND_CACHE) continue;
+			if (volume->read_hits >= last->read_hits && volume->read_misses >= last->read_misses)
+				volume->read_hit_recent = Dm_Ratio(volume->read_hits - last->read_hits,
+				                                   volume->read_misses - last->read_misses);
+			if (volume->write_hits >= last->write_hits && volume->write_misses >= last->write_misses)
+				volume->write_hit_recent = Dm_Ratio(volume->write_hits - last->write_hits,
+				                                    volume->write_misses - last->write_misses);
+			break;
+		}
+	}
+	memcpy(Dm_table, table, count * sizeof(table[0]));
+	Dm_count = count;
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the volumes from the last sample.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of volumes copied
+*  Globals: none
+****************************************************************************/
+int Dm_Volumes(struct dm_volume_type *list, int max)
+{
+	int count = (Dm_count < max) ? Dm_count : max;
+
+	memcpy(list, Dm_table, count * sizeof(list[0]));
+	return(count);
+}
@@ -0,0 +1,38 @@
+/*************************************************************************
+* Header file for NASsie_dm
+*
+* LVM thin pool and cache statistics from device mapper status
+*
+*************************************************************************/
+
+#ifndef _NASSIE_DM_H_
+#define _NASSIE_DM_H_
+
+#define DM_MAX_VOLUMES 16
+
+enum dm_kind_type {DM_KIND_OTHER, DM_KIND_THIN_POOL, DM_KIND_THIN, DM_KIND_CACHE};
+
+/* Status of one device mapper volume, only the fields of its kind are set */
+struct dm_volume_type {
+	char device[32];                //dm-0
+	char name[128];                 //vg-lv
+	enum dm_kind_type kind;
+	/* thin pool, blocks */
+	unsigned long long meta_used, meta_total, data_used, data_total;
+	int read_only, out_of_space, needs_check;
+	double data_percent, meta_percent;
+	/* thin volume, sectors */
+	unsigned long long mapped, size;
+	/* cache */
+	unsigned long long cache_used, cache_total, dirty;
+	unsigned long long read_hits, read_misses, write_hits, write_misses;
+	unsigned long long demotions, promotions;
+	double read_hit_ratio, write_hit_ratio;     //percent since the volume was set up
+	double read_hit_recent, write_hit_recent;   //percent since the last sample, -1 if no I/O
+};
+
+int Dm_Status(const char *name, struct dm_volume_type *volume);
+int Dm_Sample();
+int Dm_Volumes(struct dm_volume_type *list, int max);
+
+#endif
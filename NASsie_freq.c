@@ -0,0 +1,270 @@
+/*************************************************************************
+*                               NASsie_freq
+*                  CPU frequency and throttling for NASsie
+*
+*   Reads the frequency of each cpufreq policy from
+* /sys/devices/system/cpu/cpufreq/policyN, files kept open. The throttle
+* state comes from the firmware the way vcgencmd get_throttled asks for it:
+* a property message through the /dev/vcio mailbox ioctl, without starting
+* vcgencmd. Without the mailbox the rpi_volt hwmon is used, which only
+* knows about under-voltage; its sticky bit is kept here. Not thread safe,
+* used from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include "NASsie_freq.h"
+#include "NASsie_source.h"
+
+#define FREQ_CPUFREQ "/sys/devices/system/cpu/cpufreq"
+#define FREQ_HWMON   "/sys/class/hwmon"
+
+/* VideoCore mailbox, see the firmware wiki "Mailbox property interface" */
+#define FREQ_MBOX_PROPERTY   _IOWR(100, 0, char *)
+#define FREQ_MBOX_REQUEST    0x00000000
+#define FREQ_MBOX_SUCCESS    0x80000000
+#define FREQ_TAG_THROTTLED   0x00030046
+
+/* Attributes of a policy read every sample */
+enum freq_attribute_type {FREQ_CUR, FREQ_MIN, FREQ_MAX, FREQ_ATTRIBUTES};
+static const char *Freq_attribute[FREQ_ATTRIBUTES] = {"scaling_cur_freq", "scaling_min_freq", "scaling_max_freq"};
+
+/* A policy with its files */
+struct freq_watch_type {
+	struct freq_policy_type policy;
+	char path[FREQ_ATTRIBUTES][80];
+	char buffer[FREQ_ATTRIBUTES][32];
+	struct source_type source[FREQ_ATTRIBUTES];
+};
+
+/* GLOBAL VARIBLES */
+static struct freq_watch_type Freq_table[FREQ_MAX_POLICIES];
+static int Freq_count = 0;
+static int Freq_vcio = -1;              //open /dev/vcio
+static char Freq_alarm_path[80];
+static char Freq_alarm_buffer[16];
+static struct source_type Freq_alarm = SOURCE(Freq_alarm_path, Freq_alarm_buffer); //rpi_volt under-voltage
+static unsigned int Freq_sticky = 0;    //occurred bits when the hwmon is used
+
+/***************************************************************************
+*SUMMARY:
+*  Read a number from a small sysfs file once.
+*
+*  Parameters: path
+*  Return: number, 0 if it cannot be read
+*  Globals: none
+****************************************************************************/
+static int Freq_Number(const char *path)
+{
+	char buffer[32];
+	struct source_type src = SOURCE(path, buffer);
+	const char *p = buffer;
+	int value = 0;
+
+	if (Source_Read(&src) > 0) value = Source_Unsigned(&p);
+	Source_Close(&src);
+	return(value);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Sort policies by number, policy10 after policy2.
+*
+*  Parameters: a, b (policies)
+*  Return: order
+*  Globals: none
+****************************************************************************/
+static int Freq_Compare(const void *a, const void *b)
+{
+	return(atoi(((const struct freq_watch_type *)a)->policy.name + 6) -
+	       atoi(((const struct freq_watch_type *)b)->policy.name + 6));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Find the rpi_volt hwmon, whose in0_lcrit_alarm is set while the supply
+*  is under-voltage.
+*
+*  Parameters: none
+*  Return: error code, 1 if there is none
+*  Globals: Freq_alarm_path
+****************************************************************************/
+static int Freq_Find_alarm()
+{
+	char path[80], name[32];
+	struct source_type src = SOURCE(path, name);
+	struct dirent *entry;
+	DIR *dir;
+	int found = 0;
+
+	dir = opendir(FREQ_HWMON);
+	if (dir == NULL) return(1);
+	while (!found && (entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.') continue;
+		snprintf(path, sizeof(path), FREQ_HWMON "/%.32s/name", entry->d_name);
+		if (Source_Read(&src) > 0 && Source_Word(name, "rpi_volt") != NULL) {
+			snprintf(Freq_alarm_path, sizeof(Freq_alarm_path), FREQ_HWMON "/%.32s/in0_lcrit_alarm", entry->d_name);
+			found = 1;
+		}
+		Source_Close(&src);
+	}
+	closedir(dir);
+	return(found ? 0 : 1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Find the cpufreq policies and open the firmware mailbox. A CPU without
+*  cpufreq has no policies; without the mailbox or the hwmon the throttle
+*  state is unknown.
+*
+*  Parameters: none
+*  Return: error code, 1 if neither frequency nor throttling can be read
+*  Globals: Freq_table, Freq_count, Freq_vcio
+****************************************************************************/
+int Freq_Init()
+{
+	struct freq_watch_type *watch;
+	struct dirent *entry;
+	char path[80];
+	DIR *dir;
+	int i, j;
+
+	for (i=0; i<Freq_count; i++)			//called again: policies may have changed
+		for (j=0; j<FREQ_ATTRIBUTES; j++)
+			Source_Close(&Freq_table[i].source[j]);
+	Freq_count = 0;
+	dir = opendir(FREQ_CPUFREQ);
+	if (dir != NULL) {
+		while ((entry = readdir(dir)) != NULL && Freq_count < FREQ_MAX_POLICIES) {
+			if (strncmp(entry->d_name, "policy", 6) != 0) continue;
+			watch = &Freq_table[Freq_count++];
+			memset(watch, 0, sizeof(*watch));
+			snprintf(watch->policy.name, sizeof(watch->policy.name), "%.15s", entry->d_name);
+		}
+		closedir(dir);
+	}
+	qsort(Freq_table, Freq_count, sizeof(Freq_table[0]), Freq_Compare);
+
+	for (i=0; i<Freq_count; i++) {			//set up after sorting, sources point into the entry
+		watch = &Freq_table[i];
+		for (j=0; j<FREQ_ATTRIBUTES; j++) {
+			snprintf(watch->path[j], sizeof(watch->path[j]), FREQ_CPUFREQ "/%.15s/%s",
+			         watch->policy.name, Freq_attribute[j]);
+			watch->source[j].path = watch->path[j];
+			watch->source[j].fd = -1;
+			watch->source[j].buffer = watch->buffer[j];
+			watch->source[j].size = sizeof(watch->buffer[j]);
+		}
+		snprintf(path, sizeof(path), FREQ_CPUFREQ "/%.15s/cpuinfo_max_freq", watch->policy.name);
+		watch->policy.hardware_max = Freq_Number(path);
+	}
+
+	if (Freq_vcio < 0)
+		Freq_vcio = open("/dev/vcio", O_RDWR | O_CLOEXEC);
+	if (Freq_vcio < 0 && Freq_alarm_path[0] == '\0')
+		Freq_Find_alarm();
+
+	Freq_Sample();
+	return((Freq_count == 0 && Freq_vcio < 0 && Freq_alarm_path[0] == '\0') ? 1 : 0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the frequencies of all policies.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Freq_table
+****************************************************************************/
+int Freq_Sample()
+{
+	int *value[FREQ_ATTRIBUTES];
+	const char *p;
+	int i, j, error = 0;
+
+	for (i=0; i<Freq_count; i++) {
+		value[FREQ_CUR] = &Freq_table[i].policy.cur;
+		value[FREQ_MIN] = &Freq_table[i].policy.min;
+		value[FREQ_MAX] = &Freq_table[i].policy.max;
+		for (j=0; j<FREQ_ATTRIBUTES; j++) {
+			if (Source_Read(&Freq_table[i].source[j]) < 0) {
+				error = 1;				//policy offline with its cores
+				*value[j] = 0;
+				continue;
+			}
+			p = Freq_table[i].source[j].buffer;
+			*value[j] = Source_Unsigned(&p);
+		}
+	}
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the policies from the last sample.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of policies copied
+*  Globals: none
+****************************************************************************/
+int Freq_Policies(struct freq_policy_type *list, int max)
+{
+	int i, count = (Freq_count < max) ? Freq_count : max;
+
+	for (i=0; i<count; i++)
+		list[i] = Freq_table[i].policy;
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Ask the firmware for the throttle state. The message is the property
+*  buffer: size, request code, then the tag with its value buffer size,
+*  request/response size and value (0: do not clear the sticky bits), and
+*  the end tag.
+*
+*  Parameters: bits (result, FREQ_* and FREQ_* << FREQ_OCCURRED)
+*  Return: error code, 1 if the state is unknown
+*  Globals: Freq_vcio, Freq_alarm, Freq_sticky
+****************************************************************************/
+int Freq_Throttled(unsigned int *bits)
+{
+	unsigned int message[8] __attribute__((aligned(16)));
+	const char *p;
+
+	if (Freq_vcio >= 0) {
+		message[0] = 7 * sizeof(message[0]);
+		message[1] = FREQ_MBOX_REQUEST;
+		message[2] = FREQ_TAG_THROTTLED;
+		message[3] = sizeof(message[0]);
+		message[4] = 0;
+		message[5] = 0;
+		message[6] = 0;					//end tag
+		if (ioctl(Freq_vcio, FREQ_MBOX_PROPERTY, message) == 0 && message[1] == FREQ_MBOX_SUCCESS) {
+			*bits = message[5];
+			return(0);
+		}
+	}
+
+	if (Freq_alarm_path[0] != '\0' && Source_Read(&Freq_alarm) > 0) {
+		p = Freq_alarm.buffer;
+		*bits = Source_Unsigned(&p) ? FREQ_UNDER_VOLTAGE : 0;
+		Freq_sticky |= *bits << FREQ_OCCURRED;
+		*bits |= Freq_sticky;
+		return(0);
+	}
+	*bits = 0;
+	return(1);
+}
@@ -0,0 +1,33 @@
+/*************************************************************************
+* Header file for NASsie_freq
+*
+* CPU frequency of each cpufreq policy and the firmware throttle state
+*
+*************************************************************************/
+
+#ifndef _NASSIE_FREQ_H_
+#define _NASSIE_FREQ_H_
+
+#define FREQ_MAX_POLICIES 8
+
+/* Firmware throttle bits, as vcgencmd get_throttled shows them. The same
+   bits shifted by FREQ_OCCURRED are set if it happened since boot */
+#define FREQ_UNDER_VOLTAGE 0x1
+#define FREQ_CAPPED        0x2  //ARM frequency capped
+#define FREQ_THROTTLED     0x4
+#define FREQ_SOFT_TEMP     0x8  //soft temperature limit active
+#define FREQ_OCCURRED      16
+
+/* One cpufreq policy, the cores that change frequency together */
+struct freq_policy_type {
+	char name[16];                  //policy0
+	int cur, min, max;              //kHz, max is the current limit
+	int hardware_max;               //kHz, fastest the CPU can go
+};
+
+int Freq_Init();
+int Freq_Sample();
+int Freq_Policies(struct freq_policy_type *list, int max);
+int Freq_Throttled(unsigned int *bits);
+
+#endif
@@ -0,0 +1,340 @@
+/*************************************************************************
+*                               NASsie_fs
+*                     File system usage for NASsie
+*
+*   Maps block devices to mount points with /proc/self/mountinfo and reads
+* the usage with statvfs. The mount table is kept open and only read again
+* when poll says it changed, so a sample is a few system calls and cheap
+* enough to take every second. The file systems worth showing are picked
+* from the table when it is read; a sweep over them is one statvfs each.
+* Not thread safe, used from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/sysmacros.h>
+#include "NASsie_fs.h"
+
+/* FUSE file systems that pool real disks */
+static const char *Fs_pool_type[] = {"fuse.mergerfs", "fuse.mhddfs", "fuse.unionfs"};
+
+/* Block devices that do not hold data to show */
+static const char *Fs_skip_source[] = {"/dev/loop", "/dev/zram", "/dev/ram"};
+
+/* GLOBAL VARIBLES */
+static struct fs_mount_type Fs_table[FS_MAX_MOUNTS];
+static int Fs_count = 0;
+static int Fs_fd = -1;                  //open /proc/self/mountinfo
+static int Fs_read = 0;                 //table has been read
+static unsigned int Fs_generation = 0;  //bumped every time the table is read
+static char Fs_buffer[65536];
+static struct fs_volume_type Fs_volume[FS_MAX_VOLUMES];
+static int Fs_volume_count = 0;
+static unsigned int Fs_volume_generation = 0;   //of the table the volumes are from
+
+/***************************************************************************
+*SUMMARY:
+*  Copy one space separated mountinfo field, undoing the octal escapes
+*  (\040 for space and so on) used for paths.
+*
+*  Parameters: src (field start), dst, size of dst
+*  Return: pointer after the field
+*  Globals: none
+****************************************************************************/
+static char *Fs_Field(char *src, char *dst, int size)
+{
+	int n = 0;
+
+	while (*src == ' ') src++;
+	while (*src != ' ' && *src != '\n' && *src != '\0') {
+		if (src[0] == '\\' && src[1] >= '0' && src[1] <= '3' && src[2] >= '0' && src[2] <= '7'
+		    && src[3] >= '0' && src[3] <= '7') {
+			if (n < size-1) dst[n++] = (src[1]-'0')*64 + (src[2]-'0')*8 + (src[3]-'0');
+			src += 4;
+		} else {
+			if (n < size-1) dst[n++] = *src;
+			src++;
+		}
+	}
+	dst[n] = '\0';
+	return(src);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read /proc/self/mountinfo into the mount table. A line looks like
+*    36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw
+*  with any number of optional fields before the "-".
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Fs_table, Fs_count
+****************************************************************************/
+static int Fs_Read_mounts()
+{
+	char *line, *next, *p;
+	unsigned int major, minor;
+	struct fs_mount_type *m;
+	int len = 0, n;
+
+	if (lseek(Fs_fd, 0, SEEK_SET) < 0) return(1);
+	while ((n = read(Fs_fd, Fs_buffer + len, sizeof(Fs_buffer) - 1 - len)) > 0)
+		len += n;
+	if (n < 0) return(1);
+	Fs_buffer[len] = '\0';
+
+	Fs_count = 0;
+	for (line = Fs_buffer; *line != '\0' && Fs_count < FS_MAX_MOUNTS; line = next) {
+		next = strchr(line, '\n');
+		if (next == NULL) break;			//table larger than the buffer
+		*next++ = '\0';
+
+		m = &Fs_table[Fs_count];
+		if (sscanf(line, "%*d %*d %u:%u%n", &major, &minor, &n) != 2) continue;
+		m->dev = makedev(major, minor);
+		p = Fs_Field(line + n, m->root, sizeof(m->root));
+		p = Fs_Field(p, m->mount, sizeof(m->mount));
+		p = strstr(p, " - ");				//end of the optional fields
+		if (p == NULL) continue;
+		p = Fs_Field(p + 3, m->type, sizeof(m->type));
+		Fs_Field(p, m->source, sizeof(m->source));
+		Fs_count++;
+	}
+	Fs_read = 1;
+	Fs_generation++;
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the mount table again if it changed. The kernel flags a change of
+*  the mount namespace as POLLPRI on an open mountinfo file.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Fs_fd, Fs_read
+****************************************************************************/
+static int Fs_Refresh()
+{
+	struct pollfd pfd;
+
+	if (Fs_fd < 0 && Fs_Init() != 0) return(1);
+
+	pfd.fd = Fs_fd;
+	pfd.events = POLLPRI;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR)))
+		Fs_read = 0;
+	if (!Fs_read) return(Fs_Read_mounts());
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Open the mount table and read it.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Fs_fd
+****************************************************************************/
+int Fs_Init()
+{
+	if (Fs_fd < 0) {
+		Fs_fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+		if (Fs_fd < 0) return(1);
+	}
+	return(Fs_Read_mounts());
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the mount table.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of entries copied
+*  Globals: none
+****************************************************************************/
+int Fs_Mounts(struct fs_mount_type *list, int max)
+{
+	int count;
+
+	if (Fs_Refresh() != 0) return(0);
+	count = (Fs_count < max) ? Fs_count : max;
+	memcpy(list, Fs_table, count * sizeof(list[0]));
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Find where a block device is mounted. If it is mounted more than once
+*  (bind mounts) the mount of the whole file system is preferred.
+*
+*  Parameters: device (e.g. /dev/dm-0), mount (result)
+*  Return: 0 if found, 1 if the device does not exist or is not mounted
+*  Globals: none
+****************************************************************************/
+int Fs_Find_dev(const char *device, struct fs_mount_type *mount)
+{
+	struct stat st;
+	int i, found = -1;
+
+	if (stat(device, &st) != 0 || !S_ISBLK(st.st_mode)) return(1);
+	if (Fs_Refresh() != 0) return(1);
+
+	for (i=0; i<Fs_count; i++) {
+		if (Fs_table[i].dev != st.st_rdev) continue;
+		if (found < 0 || (strcmp(Fs_table[i].root, "/") == 0 && strcmp(Fs_table[found].root, "/") != 0))
+			found = i;
+	}
+	if (found < 0) return(1);
+	*mount = Fs_table[found];
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Usage of the file system holding path. The percentage is what df shows:
+*  used over what normal users can have, rounded up.
+*
+*  Parameters: path, usage (result)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Fs_Usage(const char *path, struct fs_usage_type *usage)
+{
+	struct statvfs sv;
+	unsigned long long used, avail, total;
+
+	if (statvfs(path, &sv) != 0) return(1);
+
+	total = sv.f_blocks;
+	used = sv.f_blocks - sv.f_bfree;
+	avail = sv.f_bavail;
+	usage->total = total * sv.f_frsize;
+	usage->used = used * sv.f_frsize;
+	usage->avail = avail * sv.f_frsize;
+	usage->percent = (used + avail) ? (int)((used * 100 + used + avail - 1) / (used + avail)) : 0;
+
+	usage->inodes = sv.f_files;
+	usage->inodes_used = sv.f_files - sv.f_ffree;
+	usage->inodes_percent = sv.f_files ? (int)((usage->inodes_used * 100 + sv.f_files - 1) / sv.f_files) : 0;
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Usage of the file system on a block device, like df /dev/xxx.
+*
+*  Parameters: device, usage (result)
+*  Return: error code, 1 if the device is missing or not mounted
+*  Globals: none
+****************************************************************************/
+int Fs_Usage_dev(const char *device, struct fs_usage_type *usage)
+{
+	struct fs_mount_type mount;
+
+	if (Fs_Find_dev(device, &mount) != 0) return(1);
+	return(Fs_Usage(mount.mount, usage));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Tell if a mount holds data worth showing: a file system on a block
+*  device (not a loop, zram or ram disk) or a FUSE pool.
+*
+*  Parameters: m (mount)
+*  Return: 1 if it does
+*  Globals: none
+****************************************************************************/
+static int Fs_Data(const struct fs_mount_type *m)
+{
+	int i;
+
+	for (i=0; i<sizeof(Fs_pool_type)/sizeof(Fs_pool_type[0]); i++)
+		if (strcmp(m->type, Fs_pool_type[i]) == 0) return(1);
+	if (strncmp(m->source, "/dev/", 5) != 0) return(0);
+	for (i=0; i<sizeof(Fs_skip_source)/sizeof(Fs_skip_source[0]); i++)
+		if (strncmp(m->source, Fs_skip_source[i], strlen(Fs_skip_source[i])) == 0) return(0);
+	return(1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Pick the volumes from the mount table. A file system mounted more than
+*  once (bind mounts) is listed at the mount of the whole file system. The
+*  name is the last part of the mount point, or of the device for the
+*  /srv/dev-disk-by-* mount points openmediavault makes.
+*
+*  Parameters: none
+*  Return: none
+*  Globals: Fs_volume, Fs_volume_count, Fs_volume_generation
+****************************************************************************/
+static void Fs_Find_volumes()
+{
+	struct fs_mount_type *m;
+	struct fs_volume_type *v;
+	const char *name;
+	int whole[FS_MAX_VOLUMES];              //listed at the mount of the whole file system
+	int i, j;
+
+	Fs_volume_count = 0;
+	for (i=0; i<Fs_count; i++) {
+		m = &Fs_table[i];
+		if (!Fs_Data(m)) continue;
+		for (j=0; j<Fs_volume_count; j++)
+			if (Fs_volume[j].dev == m->dev) break;
+		if (j < Fs_volume_count) {
+			if (whole[j] || strcmp(m->root, "/") != 0) continue;	//bind mount of a volume already listed
+		} else {
+			if (Fs_volume_count == FS_MAX_VOLUMES) break;
+			Fs_volume_count++;
+		}
+		whole[j] = (strcmp(m->root, "/") == 0);
+		v = &Fs_volume[j];
+		memset(v, 0, sizeof(*v));
+		v->dev = m->dev;
+		strcpy(v->mount, m->mount);
+		strcpy(v->type, m->type);
+		name = strrchr(m->mount, '/');
+		name = (name != NULL && name[1] != '\0') ? name + 1 : m->mount;
+		if (strncmp(name, "dev-disk-by-", 12) == 0 && strrchr(m->source, '/') != NULL)
+			name = strrchr(m->source, '/') + 1;
+		snprintf(v->name, sizeof(v->name), "%.31s", name);
+	}
+	Fs_volume_generation = Fs_generation;
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Usage of all volumes, in the order of the mount table. The volumes are
+*  only picked again when the mount table changed, so this is one statvfs
+*  per volume. A volume that can not be read is left out.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of volumes copied
+*  Globals: Fs_volume
+****************************************************************************/
+int Fs_Volumes(struct fs_volume_type *list, int max)
+{
+	int i, count = 0;
+
+	if (Fs_Refresh() != 0) return(0);
+	if (Fs_volume_generation != Fs_generation) Fs_Find_volumes();
+	for (i=0; i<Fs_volume_count && count < max; i++) {
+		if (Fs_Usage(Fs_volume[i].mount, &Fs_volume[i].usage) != 0) continue;
+		list[count++] = Fs_volume[i];
+	}
+	return(count);
+}
@@ -0,0 +1,52 @@
+/*************************************************************************
+* Header file for NASsie_fs
+*
+* File system usage from statvfs, mounts from /proc/self/mountinfo
+*
+*************************************************************************/
+
+#ifndef _NASSIE_FS_H_
+#define _NASSIE_FS_H_
+
+#include <sys/types.h>
+
+#define FS_MAX_MOUNTS 128
+#define FS_PATH_SIZE  256
+#define FS_MAX_VOLUMES 32
+
+struct fs_mount_type {
+	dev_t dev;                      //major:minor of the file system
+	char root[FS_PATH_SIZE];        //directory of the file system mounted
+	char mount[FS_PATH_SIZE];       //mount point
+	char type[32];
+	char source[FS_PATH_SIZE];
+};
+
+struct fs_usage_type {
+	unsigned long long total;       //bytes
+	unsigned long long used;
+	unsigned long long avail;       //free for normal users
+	unsigned long long inodes;
+	unsigned long long inodes_used;
+	int percent;                    //used, rounded up like df
+	int inodes_percent;
+};
+
+/* A file system holding data: on a block device or a FUSE pool (mergerfs
+   and the like). Listed once even if it is mounted more than once */
+struct fs_volume_type {
+	dev_t dev;
+	char name[32];                  //for the screen: sda1, vg-data, pool
+	char mount[FS_PATH_SIZE];
+	char type[32];
+	struct fs_usage_type usage;
+};
+
+int Fs_Init();
+int Fs_Mounts(struct fs_mount_type *list, int max);
+int Fs_Find_dev(const char *device, struct fs_mount_type *mount);
+int Fs_Usage(const char *path, struct fs_usage_type *usage);
+int Fs_Usage_dev(const char *device, struct fs_usage_type *usage);
+int Fs_Volumes(struct fs_volume_type *list, int max);
+
+#endif
@@ -0,0 +1,280 @@
+/*************************************************************************
+*                                NASsie_md
+*                     Software RAID arrays for NASsie
+*
+*   Reads the state of the md arrays in the block device registry from
+* /sys/block/mdX/md. The attributes are kept open. The kernel notifies
+* changes of array_state, sync_action, sync_completed and degraded as
+* POLLPRI on the open files, so a sample is one poll that does not wait,
+* and an array is only read again when it was notified or while a sync is
+* running (sync_speed is never notified). Not thread safe, used from the
+* main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include "NASsie_md.h"
+#include "NASsie_block.h"
+#include "NASsie_source.h"
+
+/* Attributes of an array, the first MD_NOTIFIED are notified by the kernel */
+enum md_attribute_type {MD_ARRAY_STATE, MD_SYNC_ACTION, MD_SYNC_COMPLETED, MD_DEGRADED,
+                        MD_SYNC_SPEED, MD_MISMATCH_CNT, MD_ATTRIBUTES};
+#define MD_NOTIFIED 4
+
+static const char *Md_attribute[MD_ATTRIBUTES] = {"array_state", "sync_action", "sync_completed",
+                                                   "degraded", "sync_speed", "mismatch_cnt"};
+
+/* An array with its attribute files */
+struct md_watch_type {
+	struct md_array_type array;
+	char path[MD_ATTRIBUTES][64];
+	char buffer[MD_ATTRIBUTES][64];
+	struct source_type source[MD_ATTRIBUTES];
+};
+
+/* GLOBAL VARIBLES */
+static struct md_watch_type Md_table[MD_MAX_ARRAYS];
+static int Md_count = 0;
+static unsigned int Md_generation = 0;  //Block_Generation of the table
+static int Md_listed = 0;               //table has been filled
+
+/***************************************************************************
+*SUMMARY:
+*  Copy the first word of an attribute.
+*
+*  Parameters: text, word (result), size of word
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Md_Word(const char *text, char *word, int size)
+{
+	const char *start;
+	int len;
+
+	start = Source_Token(&text, &len);
+	if (len > size - 1) len = size - 1;
+	memcpy(word, start, len);
+	word[len] = '\0';
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Check if a resync, recovery, check or reshape is running.
+*
+*  Parameters: array
+*  Return: 1 if syncing
+*  Globals: none
+****************************************************************************/
+static int Md_Syncing(const struct md_array_type *array)
+{
+	return(array->action[0] != '\0' && strcmp(array->action, "idle") != 0 && strcmp(array->action, "frozen") != 0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Set up the attribute files of an array and read the ones that do not
+*  change: the level and the number of devices. A raid0 or linear array has
+*  no sync or degraded files, those stay closed and read as empty.
+*
+*  Parameters: watch, name (md0)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Md_Open(struct md_watch_type *watch, const char *name)
+{
+	char path[64], buffer[64];
+	struct source_type fixed = SOURCE(path, buffer);
+	const char *p;
+	int i;
+
+	memset(watch, 0, sizeof(*watch));
+	snprintf(watch->array.name, sizeof(watch->array.name), "%.31s", name);
+	for (i=0; i<MD_ATTRIBUTES; i++) {
+		snprintf(watch->path[i], sizeof(watch->path[i]), "/sys/block/%.31s/md/%s", name, Md_attribute[i]);
+		watch->source[i].path = watch->path[i];
+		watch->source[i].fd = -1;
+		watch->source[i].buffer = watch->buffer[i];
+		watch->source[i].size = sizeof(watch->buffer[i]);
+	}
+
+	snprintf(path, sizeof(path), "/sys/block/%.31s/md/level", name);
+	if (Source_Read(&fixed) > 0) Md_Word(buffer, watch->array.level, sizeof(watch->array.level));
+	Source_Close(&fixed);
+	snprintf(path, sizeof(path), "/sys/block/%.31s/md/raid_disks", name);
+	if (Source_Read(&fixed) > 0) {
+		p = buffer;
+		watch->array.raid_disks = Source_Unsigned(&p);
+	}
+	Source_Close(&fixed);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Close the attribute files of an array.
+*
+*  Parameters: watch
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Md_Close(struct md_watch_type *watch)
+{
+	int i;
+
+	for (i=0; i<MD_ATTRIBUTES; i++)
+		Source_Close(&watch->source[i]);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the attributes of an array again. sync_completed is
+*  "<done> / <total>" in sectors, or "none" or "delayed"; sync_speed is in
+*  kB/s or "none". Reading a notified file also clears the notification.
+*
+*  Parameters: watch
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Md_Read(struct md_watch_type *watch)
+{
+	struct md_array_type *a = &watch->array;
+	char *buffer[MD_ATTRIBUTES];
+	const char *p;
+	int i;
+
+	for (i=0; i<MD_ATTRIBUTES; i++) {
+		Source_Read(&watch->source[i]);
+		buffer[i] = watch->source[i].buffer;
+	}
+	Md_Word(buffer[MD_ARRAY_STATE], a->state, sizeof(a->state));
+	Md_Word(buffer[MD_SYNC_ACTION], a->action, sizeof(a->action));
+	p = buffer[MD_DEGRADED];
+	a->degraded = Source_Unsigned(&p);
+	p = buffer[MD_MISMATCH_CNT];
+	a->mismatches = Source_Unsigned(&p);
+
+	a->done = a->total = 0;
+	a->speed = 0;
+	a->percent = -1.0;
+	a->eta = -1;
+	if (!Md_Syncing(a)) return;
+	p = buffer[MD_SYNC_COMPLETED];
+	if (*p >= '0' && *p <= '9') {
+		a->done = Source_Unsigned(&p);
+		a->total = Source_Unsigned(&p);
+	}
+	p = buffer[MD_SYNC_SPEED];
+	a->speed = Source_Unsigned(&p);
+	if (a->total > 0 && a->done <= a->total) {
+		a->percent = 100.0 * a->done / a->total;
+		if (a->speed > 0)
+			a->eta = (a->total - a->done) / 2 / a->speed;	//sectors to kB
+	}
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Make the table follow the md arrays in the block device registry.
+*  Arrays still there keep their open files.
+*
+*  Parameters: none
+*  Return: none
+*  Globals: Md_table, Md_count, Md_generation
+****************************************************************************/
+static void Md_List()
+{
+	struct block_device_type list[BLOCK_MAX_DEVICES];
+	static struct md_watch_type table[MD_MAX_ARRAYS];
+	int i, j, n, count = 0;
+
+	Md_generation = Block_Generation();
+	n = Block_List(list, BLOCK_MAX_DEVICES);
+	for (i=0; i<n && count<MD_MAX_ARRAYS; i++) {
+		if (list[i].kind != BLOCK_MD) continue;
+		for (j=0; j<Md_count; j++)
+			if (strcmp(Md_table[j].array.name, list[i].name) == 0) break;
+		if (j < Md_count) {
+			table[count] = Md_table[j];
+			Md_table[j].array.name[0] = '\0';			//taken, not closed below
+		} else {
+			Md_Open(&table[count], list[i].name);
+			Md_Read(&table[count]);
+		}
+		count++;
+	}
+	for (j=0; j<Md_count; j++)
+		if (Md_table[j].array.name[0] != '\0') Md_Close(&Md_table[j]);
+
+	for (i=0; i<count; i++) {
+		Md_table[i] = table[i];
+		for (j=0; j<MD_ATTRIBUTES; j++) {		//sources point into the entry they are in
+			Md_table[i].source[j].path = Md_table[i].path[j];
+			Md_table[i].source[j].buffer = Md_table[i].buffer[j];
+		}
+	}
+	Md_count = count;
+	Md_listed = 1;
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Bring the arrays up to date. Only arrays that were notified, or are
+*  syncing, are read again.
+*
+*  Parameters: none
+*  Return: number of arrays
+*  Globals: Md_table
+****************************************************************************/
+int Md_Sample()
+{
+	struct pollfd pfd[MD_MAX_ARRAYS * MD_NOTIFIED];
+	int owner[MD_MAX_ARRAYS * MD_NOTIFIED];
+	int notified[MD_MAX_ARRAYS] = {0};
+	int i, j, n = 0;
+
+	if (!Md_listed || Block_Generation() != Md_generation) Md_List();
+
+	for (i=0; i<Md_count; i++) {
+		for (j=0; j<MD_NOTIFIED; j++) {
+			if (Md_table[i].source[j].fd < 0) continue;
+			pfd[n].fd = Md_table[i].source[j].fd;
+			pfd[n].events = POLLPRI;
+			pfd[n].revents = 0;
+			owner[n++] = i;
+		}
+	}
+	if (n > 0 && poll(pfd, n, 0) > 0)
+		for (j=0; j<n; j++)
+			if (pfd[j].revents & (POLLPRI | POLLERR)) notified[owner[j]] = 1;
+
+	for (i=0; i<Md_count; i++) {
+		if (notified[i]) Md_table[i].array.events++;
+		if (notified[i] || Md_Syncing(&Md_table[i].array))
+			Md_Read(&Md_table[i]);
+	}
+	return(Md_count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the arrays from the last sample.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of arrays copied
+*  Globals: none
+****************************************************************************/
+int Md_Arrays(struct md_array_type *list, int max)
+{
+	int i, count = (Md_count < max) ? Md_count : max;
+
+	for (i=0; i<count; i++)
+		list[i] = Md_table[i].array;
+	return(count);
+}
@@ -0,0 +1,32 @@
+/*************************************************************************
+* Header file for NASsie_md
+*
+* Software RAID health and resync progress from /sys/block/mdX/md
+*
+*************************************************************************/
+
+#ifndef _NASSIE_MD_H_
+#define _NASSIE_MD_H_
+
+#define MD_MAX_ARRAYS 8
+
+/* State of one md array */
+struct md_array_type {
+	char name[32];                  //md0
+	char level[16];                 //raid1, raid5, ...
+	char state[32];                 //array_state: clean, active, broken, ...
+	char action[16];                //sync_action: idle, resync, recover, check, repair, reshape
+	int raid_disks;                 //devices in a healthy array
+	int degraded;                   //devices missing
+	unsigned long long mismatches;  //mismatch_cnt found by the last check or repair
+	unsigned long long done, total; //sync_completed in sectors, 0 when not syncing
+	int speed;                      //kB/s, 0 when not syncing
+	double percent;                 //sync done, -1 when not syncing
+	int eta;                        //seconds to the end of the sync, -1 unknown
+	unsigned int events;            //notifications from the kernel
+};
+
+int Md_Sample();
+int Md_Arrays(struct md_array_type *list, int max);
+
+#endif
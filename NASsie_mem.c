@@ -0,0 +1,149 @@
+/*************************************************************************
+*                               NASsie_mem
+*                         Memory use for NASsie
+*
+*   Parses the whole of /proc/meminfo in one pass. Each key is looked up
+* with a perfect hash: for the keys below the hash has no collisions, so a
+* lookup is one hash and one compare, and a key that is not wanted (or
+* that a newer kernel added) falls on an empty or different slot. After
+* adding a key, find a new MEM_SEED that keeps the slots unique and fill
+* the table in again.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "NASsie_mem.h"
+#include "NASsie_source.h"
+
+#define MEM_SEED  6286          //hash seed without collisions for the keys
+#define MEM_SLOTS 64            //table size, 2^MEM_BITS
+#define MEM_BITS  6
+
+/* GLOBAL VARIBLES */
+static const struct {
+	const char *key;
+	int len;
+	size_t offset;          //field in struct mem_info_type
+} Mem_keys[MEM_SLOTS] = {
+	[2] = {"Buffers", 7, offsetof(struct mem_info_type, buffers)},
+	[4] = {"Zswap", 5, offsetof(struct mem_info_type, zswap)},
+	[9] = {"MemFree", 7, offsetof(struct mem_info_type, mem_free)},
+	[10] = {"WritebackTmp", 12, offsetof(struct mem_info_type, writeback_tmp)},
+	[13] = {"Unevictable", 11, offsetof(struct mem_info_type, unevictable)},
+	[14] = {"PageTables", 10, offsetof(struct mem_info_type, page_tables)},
+	[15] = {"MemAvailable", 12, offsetof(struct mem_info_type, mem_available)},
+	[16] = {"SwapCached", 10, offsetof(struct mem_info_type, swap_cached)},
+	[17] = {"SwapTotal", 9, offsetof(struct mem_info_type, swap_total)},
+	[18] = {"MemTotal", 8, offsetof(struct mem_info_type, mem_total)},
+	[19] = {"Active(file)", 12, offsetof(struct mem_info_type, active_file)},
+	[20] = {"Committed_AS", 12, offsetof(struct mem_info_type, committed_as)},
+	[23] = {"Writeback", 9, offsetof(struct mem_info_type, writeback)},
+	[24] = {"KReclaimable", 12, offsetof(struct mem_info_type, kreclaimable)},
+	[27] = {"Active", 6, offsetof(struct mem_info_type, active)},
+	[28] = {"Mapped", 6, offsetof(struct mem_info_type, mapped)},
+	[29] = {"Dirty", 5, offsetof(struct mem_info_type, dirty)},
+	[33] = {"VmallocUsed", 11, offsetof(struct mem_info_type, vmalloc_used)},
+	[34] = {"Inactive(anon)", 14, offsetof(struct mem_info_type, inactive_anon)},
+	[36] = {"KernelStack", 11, offsetof(struct mem_info_type, kernel_stack)},
+	[39] = {"Slab", 4, offsetof(struct mem_info_type, slab)},
+	[40] = {"Shmem", 5, offsetof(struct mem_info_type, shmem)},
+	[41] = {"Cached", 6, offsetof(struct mem_info_type, cached)},
+	[42] = {"SwapFree", 8, offsetof(struct mem_info_type, swap_free)},
+	[46] = {"Mlocked", 7, offsetof(struct mem_info_type, mlocked)},
+	[52] = {"CommitLimit", 11, offsetof(struct mem_info_type, commit_limit)},
+	[55] = {"SUnreclaim", 10, offsetof(struct mem_info_type, sunreclaim)},
+	[56] = {"Inactive(file)", 14, offsetof(struct mem_info_type, inactive_file)},
+	[58] = {"Inactive", 8, offsetof(struct mem_info_type, inactive)},
+	[59] = {"AnonPages", 9, offsetof(struct mem_info_type, anon_pages)},
+	[60] = {"Active(anon)", 12, offsetof(struct mem_info_type, active_anon)},
+	[61] = {"SReclaimable", 12, offsetof(struct mem_info_type, sreclaimable)},
+};
+static char Mem_buffer[8192];
+static struct source_type Mem_source = SOURCE("/proc/meminfo", Mem_buffer);
+
+/***************************************************************************
+*SUMMARY:
+*  Slot of a key: string hash with multiplier 31, then Fibonacci hashing
+*  to take the top MEM_BITS bits.
+*
+*  Parameters: key, len
+*  Return: slot in Mem_keys
+*  Globals: none
+****************************************************************************/
+static unsigned int Mem_Hash(const char *key, int len)
+{
+	unsigned int h = MEM_SEED;
+
+	while (len-- > 0)
+		h = h * 31 + (unsigned char)*key++;
+	return((h * 2654435761u) >> (32 - MEM_BITS));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read /proc/meminfo. Lines look like
+*    MemAvailable:    3254740 kB
+*
+*  Parameters: info (result)
+*  Return: error code
+*  Globals: Mem_keys
+****************************************************************************/
+int Mem_Read(struct mem_info_type *info)
+{
+	const char *p, *key;
+	unsigned int slot;
+	int len;
+
+	memset(info, 0, sizeof(*info));
+	if (Source_Read(&Mem_source) < 0) return(1);
+
+	for (p = Mem_buffer; *p != '\0'; p = Source_Line(p)) {
+		for (key = p; *p != ':' && *p != '\n' && *p != '\0'; p++);
+		if (*p != ':') continue;
+		len = p - key;
+		slot = Mem_Hash(key, len);
+		if (Mem_keys[slot].len != len || memcmp(Mem_keys[slot].key, key, len) != 0) continue;
+		*(unsigned long long *)((char *)info + Mem_keys[slot].offset) = Source_Unsigned(&p);
+	}
+	return(info->mem_total ? 0 : 1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Memory in use as a percentage, what free shows as used. Kernels before
+*  3.14 have no MemAvailable, then free, buffers and cache count as free.
+*
+*  Parameters: info
+*  Return: percentage
+*  Globals: none
+****************************************************************************/
+int Mem_Used(const struct mem_info_type *info)
+{
+	unsigned long long avail = info->mem_available;
+
+	if (info->mem_total == 0) return(0);
+	if (avail == 0) avail = info->mem_free + info->buffers + info->cached;
+	if (avail > info->mem_total) avail = info->mem_total;
+	return(lround(100.0 * (info->mem_total - avail) / info->mem_total));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Swap in use as a percentage.
+*
+*  Parameters: info
+*  Return: percentage, 0 without swap
+*  Globals: none
+****************************************************************************/
+int Mem_Swap_used(const struct mem_info_type *info)
+{
+	if (info->swap_total == 0 || info->swap_free > info->swap_total) return(0);
+	return(lround(100.0 * (info->swap_total - info->swap_free) / info->swap_total));
+}
@@ -0,0 +1,29 @@
+/*************************************************************************
+* Header file for NASsie_mem
+*
+* Memory use from /proc/meminfo
+*
+*************************************************************************/
+
+#ifndef _NASSIE_MEM_H_
+#define _NASSIE_MEM_H_
+
+/* Fields of /proc/meminfo in kB, 0 if the kernel does not have them */
+struct mem_info_type {
+	unsigned long long mem_total, mem_free, mem_available;
+	unsigned long long buffers, cached, swap_cached;
+	unsigned long long active, inactive, active_anon, inactive_anon, active_file, inactive_file;
+	unsigned long long unevictable, mlocked;
+	unsigned long long swap_total, swap_free, zswap;
+	unsigned long long dirty, writeback, writeback_tmp;   //pages not yet on disk
+	unsigned long long anon_pages, mapped, shmem;
+	unsigned long long kreclaimable, slab, sreclaimable, sunreclaim;
+	unsigned long long kernel_stack, page_tables, vmalloc_used;
+	unsigned long long commit_limit, committed_as;
+};
+
+int Mem_Read(struct mem_info_type *info);
+int Mem_Used(const struct mem_info_type *info);
+int Mem_Swap_used(const struct mem_info_type *info);
+
+#endif
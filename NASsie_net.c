@@ -0,0 +1,579 @@
+/*************************************************************************
+*                              NASsie_net
+*                    Interface addresses for NASsie
+*
+*   Keeps a table of the IPv4 and IPv6 addresses of all interfaces. The
+* table is filled once with getifaddrs and then kept up to date by a thread
+* listening to the rtnetlink address groups, so a new DHCP lease shows up
+* as soon as the kernel has it and nothing is polled.
+*   The traffic of all interfaces is read with one RTM_GETLINK dump, which
+* has the 64 bit IFLA_STATS64 counters, on a socket of its own; if that
+* fails /proc/net/dev is read instead. The link statistics are not thread
+* safe, they are sampled from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "NASsie_net.h"
+#include "NASsie_source.h"
+
+/* GLOBAL VARIBLES */
+static struct net_address_type Net_table[NET_MAX_ADDRESSES];
+static int Net_count = 0;
+static unsigned int Net_changes = 0;   //bumped on every change of the table
+static int Net_socket = -1;
+static pthread_mutex_t Net_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct net_link_type Net_links[NET_MAX_LINKS];
+static int Net_link_count = 0;
+static int Net_link_wide = 1;          //counters are 64 bit, see Net_Delta
+static double Net_link_ms = 0;         //time of the last sample
+static int Net_link_socket = -1;
+static unsigned int Net_link_seq = 0;
+
+static int Net_Dump();
+static void *Net_Watch(void *arg);
+
+/***************************************************************************
+*SUMMARY:
+*  Addresses worth showing: loopback and IPv6 link local are left out.
+*
+*  Parameters: family, addr (in_addr or in6_addr)
+*  Return: 1 to keep the address
+*  Globals: none
+****************************************************************************/
+static int Net_Keep(int family, const void *addr)
+{
+	const struct in6_addr *a6 = addr;
+
+	if (family == AF_INET)
+		return(((const unsigned char *)addr)[0] != 127);
+	if (family == AF_INET6)
+		return(!IN6_IS_ADDR_LOOPBACK(a6) && !IN6_IS_ADDR_LINKLOCAL(a6));
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Add or remove an address in the table. Called with Net_lock held.
+*
+*  Parameters: add (1 add, 0 remove), entry
+*  Return: 1 if the table changed
+*  Globals: Net_table, Net_count, Net_changes
+****************************************************************************/
+static int Net_Change(int add, const struct net_address_type *entry)
+{
+	int i;
+
+	for (i=0; i<Net_count; i++)
+		if (Net_table[i].index == entry->index && Net_table[i].family == entry->family
+		    && strcmp(Net_table[i].ip, entry->ip) == 0)
+			break;
+
+	if (!add) {
+		if (i == Net_count) return(0);
+		Net_table[i] = Net_table[--Net_count];
+	} else if (i < Net_count) {
+		if (memcmp(&Net_table[i], entry, sizeof(*entry)) == 0) return(0);
+		Net_table[i] = *entry;
+	} else {
+		if (Net_count == NET_MAX_ADDRESSES) return(0);
+		Net_table[Net_count++] = *entry;
+	}
+	Net_changes++;
+	return(1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Open the rtnetlink socket, fill the table and start the thread that
+*  keeps it up to date. The socket is bound before the table is read so
+*  no change can be missed in between.
+*
+*  Parameters: none
+*  Return: error code, 0 when the addresses are being watched.
+*  Globals: Net_socket
+****************************************************************************/
+int Net_Init()
+{
+	struct sockaddr_nl sa;
+	pthread_t thread;
+
+	Net_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (Net_socket < 0) return(1);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	sa.nl_groups = RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+	if (bind(Net_socket, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		close(Net_socket);
+		Net_socket = -1;
+		return(1);
+	}
+
+	Net_Dump();
+	if (pthread_create(&thread, NULL, Net_Watch, NULL) != 0) return(1);
+	pthread_detach(thread);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read all addresses with getifaddrs and replace the table with them.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Net_table, Net_count, Net_changes
+****************************************************************************/
+static int Net_Dump()
+{
+	struct ifaddrs *list, *ifa;
+	struct net_address_type table[NET_MAX_ADDRESSES], *entry;
+	const void *addr, *mask;
+	int count = 0, i, size;
+
+	if (getifaddrs(&list) != 0) return(1);
+
+	for (ifa = list; ifa != NULL && count < NET_MAX_ADDRESSES; ifa = ifa->ifa_next) {
+		if (ifa->ifa_addr == NULL) continue;
+		if (ifa->ifa_addr->sa_family == AF_INET) {
+			addr = &((struct sockaddr_in *)ifa->ifa_addr)->sin_addr;
+			mask = ifa->ifa_netmask ? &((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr : NULL;
+			size = 4;
+		} else if (ifa->ifa_addr->sa_family == AF_INET6) {
+			addr = &((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr;
+			mask = ifa->ifa_netmask ? &((struct sockaddr_in6 *)ifa->ifa_netmask)->sin6_addr : NULL;
+			size = 16;
+		} else continue;
+		if (!Net_Keep(ifa->ifa_addr->sa_family, addr)) continue;
+
+		entry = &table[count++];
+		memset(entry, 0, sizeof(*entry));
+		strncpy(entry->ifname, ifa->ifa_name, IF_NAMESIZE-1);
+		entry->ifname[strcspn(entry->ifname, ":")] = '\0';	//IPv4 alias labels are eth0:1
+		entry->index = if_nametoindex(entry->ifname);
+		entry->family = ifa->ifa_addr->sa_family;
+		for (i=0; mask != NULL && i<size; i++)
+			entry->prefix += __builtin_popcount(((const unsigned char *)mask)[i]);
+		inet_ntop(entry->family, addr, entry->ip, sizeof(entry->ip));
+	}
+	freeifaddrs(list);
+
+	pthread_mutex_lock(&Net_lock);
+	if (count != Net_count || memcmp(table, Net_table, count * sizeof(table[0])) != 0) {
+		memcpy(Net_table, table, count * sizeof(table[0]));
+		Net_count = count;
+		Net_changes++;
+	}
+	pthread_mutex_unlock(&Net_lock);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Apply one RTM_NEWADDR or RTM_DELADDR message to the table.
+*
+*  Parameters: nh (netlink message)
+*  Return: none
+*  Globals: Net_table (through Net_Change)
+****************************************************************************/
+static void Net_Message(struct nlmsghdr *nh)
+{
+	struct ifaddrmsg *ifa = NLMSG_DATA(nh);
+	struct rtattr *rta;
+	struct net_address_type entry;
+	const void *addr = NULL, *local = NULL;
+	const char *label = NULL;
+	int len;
+
+	if (nh->nlmsg_type != RTM_NEWADDR && nh->nlmsg_type != RTM_DELADDR) return;
+	if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6) return;
+
+	len = IFA_PAYLOAD(nh);
+	for (rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		switch (rta->rta_type) {
+			case IFA_ADDRESS:
+				addr = RTA_DATA(rta);
+				break;
+			case IFA_LOCAL:			//own address on point to point links
+				local = RTA_DATA(rta);
+				break;
+			case IFA_LABEL:
+				label = RTA_DATA(rta);
+				break;
+		}
+	}
+	if (local != NULL) addr = local;
+	if (addr == NULL || !Net_Keep(ifa->ifa_family, addr)) return;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.index = ifa->ifa_index;
+	entry.family = ifa->ifa_family;
+	entry.prefix = ifa->ifa_prefixlen;
+	inet_ntop(entry.family, addr, entry.ip, sizeof(entry.ip));
+	if (label != NULL)
+		strncpy(entry.ifname, label, IF_NAMESIZE-1);
+	else if (if_indextoname(entry.index, entry.ifname) == NULL)
+		return;
+	entry.ifname[strcspn(entry.ifname, ":")] = '\0';	//IPv4 alias labels are eth0:1
+
+	pthread_mutex_lock(&Net_lock);
+	Net_Change(nh->nlmsg_type == RTM_NEWADDR, &entry);
+	pthread_mutex_unlock(&Net_lock);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Thread waiting for address changes from the kernel. If the socket buffer
+*  overflowed some changes are lost, so the whole table is read again.
+*
+*  Parameters: arg (not used)
+*  Return: none, never ends
+*  Globals: Net_socket
+****************************************************************************/
+static void *Net_Watch(void *arg)
+{
+	char buffer[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+	struct sockaddr_nl from;
+	socklen_t fromlen;
+	struct nlmsghdr *nh;
+	int len;
+
+	while (1) {
+		fromlen = sizeof(from);
+		len = recvfrom(Net_socket, buffer, sizeof buffer, 0, (struct sockaddr *)&from, &fromlen);
+		if (len < 0) {
+			if (errno == ENOBUFS)
+				Net_Dump();
+			else if (errno != EINTR)
+				sleep(1);
+			continue;
+		}
+		if (from.nl_pid != 0) continue;			//only trust the kernel
+
+		for (nh = (struct nlmsghdr *)buffer; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+			if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) break;
+			Net_Message(nh);
+		}
+	}
+	return(NULL);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  First address of an interface.
+*
+*  Parameters: ifname, family (AF_INET or AF_INET6), ip (result), size of ip
+*  Return: 0 if found, 1 if the interface has no address of that family
+*  Globals: none
+****************************************************************************/
+int Net_Address(const char *ifname, int family, char *ip, int size)
+{
+	int i, found = 1;
+
+	pthread_mutex_lock(&Net_lock);
+	for (i=0; i<Net_count; i++) {
+		if (Net_table[i].family == family && strcmp(Net_table[i].ifname, ifname) == 0) {
+			snprintf(ip, size, "%s", Net_table[i].ip);
+			found = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&Net_lock);
+	return(found);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the address table.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of entries copied
+*  Globals: none
+****************************************************************************/
+int Net_List(struct net_address_type *list, int max)
+{
+	int count;
+
+	pthread_mutex_lock(&Net_lock);
+	count = (Net_count < max) ? Net_count : max;
+	memcpy(list, Net_table, count * sizeof(list[0]));
+	pthread_mutex_unlock(&Net_lock);
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Change counter of the table, so callers can skip work when nothing moved.
+*
+*  Parameters: none
+*  Return: counter, bumped on every change
+*  Globals: none
+****************************************************************************/
+unsigned int Net_Generation()
+{
+	unsigned int changes;
+
+	pthread_mutex_lock(&Net_lock);
+	changes = Net_changes;
+	pthread_mutex_unlock(&Net_lock);
+	return(changes);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Dump the link statistics of all interfaces with one RTM_GETLINK
+*  request. Kernels before 2.6.35 have no IFLA_STATS64, then the 32 bit
+*  IFLA_STATS are used.
+*
+*  Parameters: list (result), count (result), wide (result, 64 bit counters)
+*  Return: error code
+*  Globals: Net_link_socket, Net_link_seq
+****************************************************************************/
+static int Net_Link_dump(struct net_link_type *list, int *count, int *wide)
+{
+	static char buffer[16384] __attribute__((aligned(NLMSG_ALIGNTO)));
+	struct {
+		struct nlmsghdr nh;
+		struct ifinfomsg ifi;
+	} request;
+	struct rtnl_link_stats64 s64;
+	struct rtnl_link_stats s32;
+	struct timeval timeout = {1, 0};
+	struct nlmsghdr *nh;
+	struct ifinfomsg *ifi;
+	struct rtattr *rta;
+	struct net_link_type *link;
+	int len, attr_len, done = 0, have64;
+
+	if (Net_link_socket < 0) {
+		Net_link_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+		if (Net_link_socket < 0) return(1);
+		setsockopt(Net_link_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.nh.nlmsg_len = NLMSG_LENGTH(sizeof(request.ifi));
+	request.nh.nlmsg_type = RTM_GETLINK;
+	request.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	request.nh.nlmsg_seq = ++Net_link_seq;
+	request.ifi.ifi_family = AF_UNSPEC;
+	if (send(Net_link_socket, &request, request.nh.nlmsg_len, 0) < 0) return(1);
+
+	*count = 0;
+	*wide = 1;
+	while (!done) {
+		len = recv(Net_link_socket, buffer, sizeof(buffer), 0);
+		if (len < 0 && errno == EINTR) continue;
+		if (len <= 0) {
+			close(Net_link_socket);		//a reply may be left half read
+			Net_link_socket = -1;
+			return(1);
+		}
+		for (nh = (struct nlmsghdr *)buffer; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+			if (nh->nlmsg_seq != Net_link_seq) continue;	//late reply to an old request
+			if (nh->nlmsg_type == NLMSG_DONE) {
+				done = 1;
+				break;
+			}
+			if (nh->nlmsg_type == NLMSG_ERROR) return(1);
+			if (nh->nlmsg_type != RTM_NEWLINK || *count == NET_MAX_LINKS) continue;
+
+			ifi = NLMSG_DATA(nh);
+			if (ifi->ifi_flags & IFF_LOOPBACK) continue;
+			link = &list[*count];
+			memset(link, 0, sizeof(*link));
+			link->index = ifi->ifi_index;
+			link->up = (ifi->ifi_flags & IFF_UP) && (ifi->ifi_flags & IFF_RUNNING);
+			have64 = 0;
+			memset(&s32, 0, sizeof(s32));
+			attr_len = IFLA_PAYLOAD(nh);
+			for (rta = IFLA_RTA(ifi); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+				if (rta->rta_type == IFLA_IFNAME)
+					strncpy(link->ifname, RTA_DATA(rta), IF_NAMESIZE-1);
+				else if (rta->rta_type == IFLA_STATS64 && RTA_PAYLOAD(rta) >= sizeof(s64)) {
+					memcpy(&s64, RTA_DATA(rta), sizeof(s64));	//attribute is only 4 byte aligned
+					have64 = 1;
+				} else if (rta->rta_type == IFLA_STATS && RTA_PAYLOAD(rta) >= sizeof(s32))
+					memcpy(&s32, RTA_DATA(rta), sizeof(s32));
+			}
+			if (have64) {
+				link->rx_bytes = s64.rx_bytes;      link->tx_bytes = s64.tx_bytes;
+				link->rx_packets = s64.rx_packets;  link->tx_packets = s64.tx_packets;
+				link->rx_errors = s64.rx_errors;    link->tx_errors = s64.tx_errors;
+				link->rx_dropped = s64.rx_dropped;  link->tx_dropped = s64.tx_dropped;
+			} else {
+				link->rx_bytes = s32.rx_bytes;      link->tx_bytes = s32.tx_bytes;
+				link->rx_packets = s32.rx_packets;  link->tx_packets = s32.tx_packets;
+				link->rx_errors = s32.rx_errors;    link->tx_errors = s32.tx_errors;
+				link->rx_dropped = s32.rx_dropped;  link->tx_dropped = s32.tx_dropped;
+				*wide = 0;
+			}
+			(*count)++;
+		}
+	}
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the link statistics from /proc/net/dev, for when rtnetlink cannot
+*  be used. A line looks like
+*    eth0: 1234 10 0 0 0 0 0 0 5678 20 0 0 0 0 0 0
+*  bytes, packets, errors, drops and four more counters, received then
+*  sent. The counters are unsigned long, 32 bit on a 32 bit kernel.
+*
+*  Parameters: list (result), count (result), wide (result, 64 bit counters)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+static int Net_Link_proc(struct net_link_type *list, int *count, int *wide)
+{
+	static char buffer[8192];
+	static struct source_type src = SOURCE("/proc/net/dev", buffer);
+	struct net_link_type *link;
+	const char *p, *name, *colon;
+	int len;
+
+	if (Source_Read(&src) < 0) return(1);
+	*count = 0;
+	*wide = (sizeof(unsigned long) == 8);
+	p = Source_Line(Source_Line(buffer));		//two header lines
+	for (; *p != '\0' && *count < NET_MAX_LINKS; p = Source_Line(p)) {
+		name = Source_Token(&p, &len);
+		colon = memchr(name, ':', len);		//a large first counter follows the colon without a space
+		if (colon == NULL) continue;
+		len = colon - name;
+		p = colon + 1;
+		if (len == 2 && strncmp(name, "lo", 2) == 0) continue;
+		link = &list[*count];
+		memset(link, 0, sizeof(*link));
+		memcpy(link->ifname, name, (len < IF_NAMESIZE) ? len : IF_NAMESIZE-1);
+		link->up = 1;
+		link->rx_bytes = Source_Unsigned(&p);
+		link->rx_packets = Source_Unsigned(&p);
+		link->rx_errors = Source_Unsigned(&p);
+		link->rx_dropped = Source_Unsigned(&p);
+		Source_Unsigned(&p); Source_Unsigned(&p); Source_Unsigned(&p); Source_Unsigned(&p);
+		link->tx_bytes = Source_Unsigned(&p);
+		link->tx_packets = Source_Unsigned(&p);
+		link->tx_errors = Source_Unsigned(&p);
+		link->tx_dropped = Source_Unsigned(&p);
+		(*count)++;
+	}
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Difference of two counters. With unsigned 64 bit arithmetic a wrapped
+*  counter still gives the right difference; counters that are only 32 bit
+*  wrap at 2^32, so the difference is taken modulo 2^32.
+*
+*  Parameters: now, last, wide (64 bit counters)
+*  Return: now - last
+*  Globals: none
+****************************************************************************/
+static double Net_Delta(unsigned long long now, unsigned long long last, int wide)
+{
+	if (wide)
+		return((double)(now - last));
+	return((double)((unsigned int)now - (unsigned int)last));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the traffic of all interfaces and work out the rates since the last
+*  sample. An interface that was not in the last sample, or came back with
+*  another index (removed and added again), starts without rates.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Net_links, Net_link_count, Net_link_wide, Net_link_ms
+****************************************************************************/
+int Net_Link_sample()
+{
+	struct net_link_type now[NET_MAX_LINKS], *link, *last;
+	struct timespec ts;
+	double ms, elapsed, errors;
+	int i, j, count, wide, pair;
+
+	if (Net_Link_dump(now, &count, &wide) != 0 && Net_Link_proc(now, &count, &wide) != 0)
+		return(1);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ms = ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+	elapsed = (ms - Net_link_ms) / 1000.0;
+	pair = wide && Net_link_wide;		//a 32 bit sample on either side wraps at 2^32
+
+	for (i=0; i<count; i++) {
+		link = &now[i];
+		for (j=0; j<Net_link_count; j++)
+			if (strcmp(Net_links[j].ifname, link->ifname) == 0) break;
+		if (j == Net_link_count || Net_links[j].index != link->index || elapsed <= 0) continue;
+		last = &Net_links[j];
+		link->rx_bytes_s = Net_Delta(link->rx_bytes, last->rx_bytes, pair) / elapsed;
+		link->tx_bytes_s = Net_Delta(link->tx_bytes, last->tx_bytes, pair) / elapsed;
+		link->rx_packets_s = Net_Delta(link->rx_packets, last->rx_packets, pair) / elapsed;
+		link->tx_packets_s = Net_Delta(link->tx_packets, last->tx_packets, pair) / elapsed;
+		errors = Net_Delta(link->rx_errors, last->rx_errors, pair) + Net_Delta(link->tx_errors, last->tx_errors, pair)
+		         + Net_Delta(link->rx_dropped, last->rx_dropped, pair) + Net_Delta(link->tx_dropped, last->tx_dropped, pair);
+		link->errors_s = errors / elapsed;
+	}
+	memcpy(Net_links, now, count * sizeof(now[0]));
+	Net_link_count = count;
+	Net_link_wide = wide;
+	Net_link_ms = ms;
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the traffic of all interfaces from the last sample.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of entries copied
+*  Globals: none
+****************************************************************************/
+int Net_Links(struct net_link_type *list, int max)
+{
+	int count = (Net_link_count < max) ? Net_link_count : max;
+
+	memcpy(list, Net_links, count * sizeof(list[0]));
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Traffic of one interface from the last sample.
+*
+*  Parameters: ifname, link (result)
+*  Return: 0 if found, 1 if the interface was not in the last sample
+*  Globals: none
+****************************************************************************/
+int Net_Link(const char *ifname, struct net_link_type *link)
+{
+	int i;
+
+	for (i=0; i<Net_link_count; i++) {
+		if (strcmp(Net_links[i].ifname, ifname) == 0) {
+			*link = Net_links[i];
+			return(0);
+		}
+	}
+	return(1);
+}
@@ -0,0 +1,46 @@
+/*************************************************************************
+* Header file for NASsie_net
+*
+* Interface addresses kept up to date by rtnetlink, and traffic of the
+* interfaces from rtnetlink link statistics
+*
+*************************************************************************/
+
+#ifndef _NASSIE_NET_H_
+#define _NASSIE_NET_H_
+
+#include <net/if.h>
+#include <netinet/in.h>
+
+#define NET_MAX_ADDRESSES 16
+#define NET_MAX_LINKS     16
+
+struct net_address_type {
+	int index;                      //interface index
+	char ifname[IF_NAMESIZE];
+	int family;                     //AF_INET or AF_INET6
+	int prefix;                     //prefix length
+	char ip[INET6_ADDRSTRLEN];
+};
+
+/* Traffic of one interface: totals since it came up, rates over the last sample */
+struct net_link_type {
+	int index;                      //interface index, 0 if read from /proc/net/dev
+	char ifname[IF_NAMESIZE];
+	int up;                         //up and running
+	unsigned long long rx_bytes, tx_bytes, rx_packets, tx_packets;
+	unsigned long long rx_errors, tx_errors, rx_dropped, tx_dropped;
+	double rx_bytes_s, tx_bytes_s;  //per second
+	double rx_packets_s, tx_packets_s;
+	double errors_s;                //errors and drops per second, both ways
+};
+
+int Net_Init();
+int Net_Address(const char *ifname, int family, char *ip, int size);
+int Net_List(struct net_address_type *list, int max);
+unsigned int Net_Generation();
+int Net_Link_sample();
+int Net_Links(struct net_link_type *list, int max);
+int Net_Link(const char *ifname, struct net_link_type *link);
+
+#endif
@@ -0,0 +1,107 @@
+/*************************************************************************
+*                              NASsie_nvme
+*                    NVMe drive health for NASsie
+*
+*   Reads the SMART/Health Information log of an NVMe drive with one Get
+* Log Page admin command through NVME_IOCTL_ADMIN_CMD, without nvme-cli.
+* The command works on the namespace block device (/dev/nvme0n1) as well
+* as the controller (/dev/nvme0) and needs CAP_SYS_ADMIN. It does not wake
+* anything up: the drive manages its own power states.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/nvme_ioctl.h>
+#include "NASsie_nvme.h"
+
+#define NVME_GET_LOG_PAGE   0x02    //admin opcode
+#define NVME_LOG_HEALTH     0x02    //SMART/Health Information
+#define NVME_LOG_SIZE       512
+#define NVME_NSID_ALL       0xFFFFFFFF  //controller wide log
+#define NVME_TIMEOUT        1000    //milliseconds
+
+/***************************************************************************
+*SUMMARY:
+*  Little endian number from the log. The 16 byte counters are cut to
+*  their low 8 bytes, which do not overflow in the life of a drive.
+*
+*  Parameters: data, len (bytes, up to 8)
+*  Return: number
+*  Globals: none
+****************************************************************************/
+static unsigned long long Nvme_Le(const unsigned char *data, int len)
+{
+	unsigned long long value = 0;
+
+	while (len-- > 0)
+		value = (value << 8) | data[len];
+	return(value);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the SMART/Health Information log of an open NVMe device. The
+*  number of dwords is 0's based, in the upper half of command dword 10.
+*
+*  Parameters: fd (NVMe block or character device), health (result)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Nvme_Health_fd(int fd, struct nvme_health_type *health)
+{
+	unsigned char log[NVME_LOG_SIZE] __attribute__((aligned(8)));
+	struct nvme_admin_cmd cmd;
+	unsigned int kelvin;
+
+	memset(log, 0, sizeof(log));
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.opcode = NVME_GET_LOG_PAGE;
+	cmd.nsid = NVME_NSID_ALL;
+	cmd.addr = (uint64_t)(uintptr_t)log;
+	cmd.data_len = sizeof(log);
+	cmd.cdw10 = ((sizeof(log) / 4 - 1) << 16) | NVME_LOG_HEALTH;
+	cmd.timeout_ms = NVME_TIMEOUT;
+	if (ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd) != 0) return(1);	//also > 0: NVMe status
+
+	kelvin = Nvme_Le(log + 1, 2);
+	if (kelvin == 0) return(1);					//no temperature reported
+	health->critical_warning = log[0];
+	health->temperature = (int)kelvin - 273;
+	health->spare = log[3];
+	health->percent_used = log[5];
+	health->data_read = Nvme_Le(log + 32, 8);
+	health->data_written = Nvme_Le(log + 48, 8);
+	health->power_on_hours = Nvme_Le(log + 128, 8);
+	health->media_errors = Nvme_Le(log + 160, 8);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the SMART/Health Information log of an NVMe device.
+*
+*  Parameters: device (e.g. /dev/nvme0n1), health (result)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Nvme_Health(const char *device, struct nvme_health_type *health)
+{
+	int fd, error;
+
+	fd = open(device, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) return(1);
+	error = Nvme_Health_fd(fd, health);
+	close(fd);
+	return(error);
+}
@@ -0,0 +1,28 @@
+/*************************************************************************
+* Header file for NASsie_nvme
+*
+* NVMe SMART/Health Information log read with admin pass-through
+*
+*************************************************************************/
+
+#ifndef _NASSIE_NVME_H_
+#define _NASSIE_NVME_H_
+
+#define NVME_UNIT_BYTES 512000ULL   //a data unit is 1000 blocks of 512 bytes
+
+/* The fields of the SMART/Health Information log (log page 02h) used */
+struct nvme_health_type {
+	int temperature;                //Celcius, composite temperature
+	int percent_used;               //wear, may go over 100
+	int spare;                      //percent of spare capacity left
+	unsigned int critical_warning;  //bits, 0 if all is well
+	unsigned long long data_read;   //data units, see NVME_UNIT_BYTES
+	unsigned long long data_written;
+	unsigned long long power_on_hours;
+	unsigned long long media_errors;
+};
+
+int Nvme_Health_fd(int fd, struct nvme_health_type *health);
+int Nvme_Health(const char *device, struct nvme_health_type *health);
+
+#endif
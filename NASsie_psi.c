@@ -0,0 +1,209 @@
+/*************************************************************************
+*                                NASsie_psi
+*                   Pressure stall information for NASsie
+*
+*   Reads how long tasks waited for CPU, memory and I/O from
+* /proc/pressure (kernel 4.20 and later, CONFIG_PSI). CPU and memory
+* percentages do not show why a transfer stutters, the stall times do.
+*   A trigger is also set on each resource: a stall threshold written to
+* the file makes the kernel signal POLLPRI when the tasks stalled longer
+* than that within the window. Psi_Wait replaces the sleep of the main
+* loop so a stall wakes it up straight away. Not thread safe, used from
+* the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include "NASsie_psi.h"
+#include "NASsie_source.h"
+
+#define PSI_WINDOW 2000000      //microseconds, unprivileged triggers need a multiple of 2s
+
+/* Stall in PSI_WINDOW that fires the trigger of each resource */
+static const char *Psi_trigger[PSI_RESOURCES] = {
+	"some 1000000 2000000",             //CPU: tasks waited half the time
+	"some 200000 2000000",              //memory: reclaim or swap 10% of the time
+	"some 500000 2000000"               //I/O: a quarter of the time
+};
+
+/* GLOBAL VARIBLES */
+static char Psi_buffer[PSI_RESOURCES][256];
+static struct source_type Psi_source[PSI_RESOURCES] = {
+	SOURCE("/proc/pressure/cpu", Psi_buffer[PSI_CPU]),
+	SOURCE("/proc/pressure/memory", Psi_buffer[PSI_MEMORY]),
+	SOURCE("/proc/pressure/io", Psi_buffer[PSI_IO])
+};
+static struct psi_type Psi_table[PSI_RESOURCES];
+static int Psi_fd[PSI_RESOURCES] = {-1, -1, -1};   //trigger of each resource
+
+/***************************************************************************
+*SUMMARY:
+*  Read a decimal number like 12.34 following "name=".
+*
+*  Parameters: line, name (e.g. "avg10=")
+*  Return: number, 0 if the line does not have it
+*  Globals: none
+****************************************************************************/
+static double Psi_Value(const char *line, const char *name)
+{
+	const char *p, *q = NULL;
+	double value, scale = 0.1;
+
+	for (p = line; *p != '\0' && *p != '\n'; p++)
+		if ((q = Source_Word(p, name)) != NULL) break;
+	if (q == NULL) return(0.0);
+
+	value = Source_Unsigned(&q);
+	if (*q == '.')
+		for (q++; *q >= '0' && *q <= '9'; q++, scale /= 10)
+			value += (*q - '0') * scale;
+	return(value);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Total stall time following "total=" on a line.
+*
+*  Parameters: line
+*  Return: microseconds
+*  Globals: none
+****************************************************************************/
+static unsigned long long Psi_Total(const char *line)
+{
+	const char *p, *q;
+
+	for (p = line; *p != '\0' && *p != '\n'; p++)
+		if ((q = Source_Word(p, "total=")) != NULL) return(Source_Unsigned(&q));
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Open the pressure files and set the triggers. Without PSI in the kernel
+*  the values stay 0 and Psi_Wait only sleeps.
+*
+*  Parameters: none
+*  Return: error code, 1 if no trigger could be set
+*  Globals: Psi_fd
+****************************************************************************/
+int Psi_Init()
+{
+	int i, len, set = 0;
+
+	for (i=0; i<PSI_RESOURCES; i++) {
+		if (Psi_fd[i] >= 0) {
+			set++;
+			continue;
+		}
+		Psi_fd[i] = open(Psi_source[i].path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (Psi_fd[i] < 0) continue;
+		len = strlen(Psi_trigger[i]) + 1;			//the kernel wants the 0
+		if (write(Psi_fd[i], Psi_trigger[i], len) != len) {
+			close(Psi_fd[i]);
+			Psi_fd[i] = -1;
+			continue;
+		}
+		set++;
+	}
+	Psi_Sample();
+	return(set ? 0 : 1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the stall times of all resources. A file has a line
+*    some avg10=0.12 avg60=0.30 avg300=0.25 total=123456
+*  and, except CPU on older kernels, a "full" line like it.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Psi_table
+****************************************************************************/
+int Psi_Sample()
+{
+	const char *line;
+	struct psi_type *psi;
+	int i, error = 0;
+
+	for (i=0; i<PSI_RESOURCES; i++) {
+		psi = &Psi_table[i];
+		psi->some_avg10 = psi->some_avg60 = psi->full_avg10 = psi->full_avg60 = 0.0;
+		if (Source_Read(&Psi_source[i]) < 0) {
+			error = 1;
+			continue;
+		}
+		for (line = Psi_source[i].buffer; *line != '\0'; line = Source_Line(line)) {
+			if (Source_Word(line, "some ") != NULL) {
+				psi->some_avg10 = Psi_Value(line, "avg10=");
+				psi->some_avg60 = Psi_Value(line, "avg60=");
+				psi->some_total = Psi_Total(line);
+			} else if (Source_Word(line, "full ") != NULL) {
+				psi->full_avg10 = Psi_Value(line, "avg10=");
+				psi->full_avg60 = Psi_Value(line, "avg60=");
+				psi->full_total = Psi_Total(line);
+			}
+		}
+	}
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Stall times of a resource from the last sample.
+*
+*  Parameters: resource, psi (result)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Psi_Read(enum psi_resource_type resource, struct psi_type *psi)
+{
+	if (resource < 0 || resource >= PSI_RESOURCES) return(1);
+	*psi = Psi_table[resource];
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Wait until the timeout or until a trigger fires, whichever comes first.
+*  A trigger fires at most once per window.
+*
+*  Parameters: timeout (milliseconds)
+*  Return: resources that fired as bits (1 << PSI_IO), 0 on timeout
+*  Globals: Psi_fd, Psi_table
+****************************************************************************/
+int Psi_Wait(int timeout)
+{
+	struct pollfd pfd[PSI_RESOURCES];
+	int owner[PSI_RESOURCES];
+	int i, n = 0, fired = 0;
+
+	for (i=0; i<PSI_RESOURCES; i++) {
+		if (Psi_fd[i] < 0) continue;
+		pfd[n].fd = Psi_fd[i];
+		pfd[n].events = POLLPRI;
+		pfd[n].revents = 0;
+		owner[n++] = i;
+	}
+	if (poll(pfd, n, timeout) <= 0) return(0);		//EINTR counts as a timeout
+
+	for (i=0; i<n; i++) {
+		if (pfd[i].revents & POLLERR) {			//trigger removed, e.g. PSI switched off
+			close(Psi_fd[owner[i]]);
+			Psi_fd[owner[i]] = -1;
+		} else if (pfd[i].revents & POLLPRI) {
+			Psi_table[owner[i]].events++;
+			fired |= 1 << owner[i];
+		}
+	}
+	return(fired);
+}
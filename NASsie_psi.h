@@ -0,0 +1,27 @@
+/*************************************************************************
+* Header file for NASsie_psi
+*
+* Pressure stall information from /proc/pressure, with stall triggers
+*
+*************************************************************************/
+
+#ifndef _NASSIE_PSI_H_
+#define _NASSIE_PSI_H_
+
+enum psi_resource_type {PSI_CPU, PSI_MEMORY, PSI_IO, PSI_RESOURCES};
+
+/* Share of time tasks were stalled on a resource, in percent. "some": at
+   least one task waited, "full": all non-idle tasks waited at once */
+struct psi_type {
+	double some_avg10, some_avg60;
+	double full_avg10, full_avg60;
+	unsigned long long some_total, full_total;  //microseconds stalled since boot
+	unsigned int events;                        //triggers fired
+};
+
+int Psi_Init();
+int Psi_Sample();
+int Psi_Read(enum psi_resource_type resource, struct psi_type *psi);
+int Psi_Wait(int timeout);
+
+#endif
@@ -0,0 +1,402 @@
+/*************************************************************************
+*                              NASsie_sensor
+*                      Sensor registry for NASsie
+*
+*   Finds the thermal zones in /sys/class/thermal and the temperature,
+* fan, voltage, current and power inputs in /sys/class/hwmon, and keeps
+* one open file per sensor. A sample reads them all in one pass with
+* pread. Screens look sensors up by label, so showing another sensor of
+* the board is a new label in a table and not new code.
+*   The sensor directories are scanned again when a uevent says a hwmon or
+* thermal device was added or removed (a driver loaded or unloaded). The
+* uevent socket does not block and is read at the start of a sample. Not
+* thread safe, used from the main loop.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "NASsie_sensor.h"
+#include "NASsie_source.h"
+
+#define SENSOR_THERMAL "/sys/class/thermal"
+#define SENSOR_HWMON   "/sys/class/hwmon"
+
+/* hwmon inputs: file name prefix, kind and the unit of the file */
+static const struct {
+	const char *prefix;
+	enum sensor_kind_type kind;
+	double scale;
+} Sensor_input[] = {
+	{"temp",  SENSOR_TEMP,    0.001},       //milli-degrees
+	{"fan",   SENSOR_FAN,     1.0},         //RPM
+	{"in",    SENSOR_VOLTAGE, 0.001},       //mV
+	{"curr",  SENSOR_CURRENT, 0.001},       //mA
+	{"power", SENSOR_POWER,   0.000001}     //uW
+};
+
+/* hwmon chips left out: reading a drivetemp input sends a command to the
+   disk, which would wake it and can hang; NVMe and drive temperatures come
+   from the probe threads of NASsie_smart, which do neither */
+static const char *Sensor_skip_chip[] = {"drivetemp", "nvme"};
+
+/* A sensor with its file */
+struct sensor_watch_type {
+	struct sensor_type sensor;
+	double scale;
+	int seen;                       //min and max hold a reading
+	char path[96];
+	char buffer[32];
+	struct source_type source;
+};
+
+/* GLOBAL VARIBLES */
+static struct sensor_watch_type Sensor_table[SENSOR_MAX];
+static int Sensor_count = 0;
+static int Sensor_socket = -1;          //uevents, does not block
+static int Sensor_scanned = 0;
+
+/***************************************************************************
+*SUMMARY:
+*  Read a short sysfs attribute, without the new line.
+*
+*  Parameters: path, value (result), size of value
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+static int Sensor_Attribute(const char *path, char *value, int size)
+{
+	struct source_type src = {path, -1, value, size, 0};
+	int len;
+
+	len = Source_Read(&src);
+	Source_Close(&src);
+	if (len < 0) return(1);
+	while (len > 0 && (value[len-1] == '\n' || value[len-1] == ' ')) value[--len] = '\0';
+	return(len ? 0 : 1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Order directory entries by their number, hwmon10 after hwmon2.
+*
+*  Parameters: a, b (entries)
+*  Return: order
+*  Globals: none
+****************************************************************************/
+static int Sensor_Compare(const struct dirent **a, const struct dirent **b)
+{
+	const char *p = (*a)->d_name, *q = (*b)->d_name;
+
+	while (*p != '\0' && *p == *q && (*p < '0' || *p > '9')) {
+		p++;
+		q++;
+	}
+	if (*p >= '0' && *p <= '9' && *q >= '0' && *q <= '9')
+		return(atoi(p) - atoi(q));
+	return(strcmp(p, q));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Add a sensor to the table being built. A sensor that was in the old
+*  table keeps its min and max.
+*
+*  Parameters: table, count (updated), label, kind, scale, path
+*  Return: none
+*  Globals: Sensor_table, Sensor_count (old table)
+****************************************************************************/
+static void Sensor_Add(struct sensor_watch_type *table, int *count, const char *label,
+                       enum sensor_kind_type kind, double scale, const char *path)
+{
+	struct sensor_watch_type *watch;
+	int i;
+
+	if (*count >= SENSOR_MAX) return;
+	watch = &table[(*count)++];
+	memset(watch, 0, sizeof(*watch));
+	snprintf(watch->sensor.label, sizeof(watch->sensor.label), "%s", label);
+	snprintf(watch->path, sizeof(watch->path), "%s", path);
+	watch->sensor.kind = kind;
+	watch->scale = scale;
+	watch->source.fd = -1;
+
+	for (i=0; i<Sensor_count; i++) {
+		if (strcmp(Sensor_table[i].sensor.label, label) != 0) continue;
+		watch->sensor.min = Sensor_table[i].sensor.min;
+		watch->sensor.max = Sensor_table[i].sensor.max;
+		watch->seen = Sensor_table[i].seen;
+		break;
+	}
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Add the thermal zones, labelled by their type.
+*
+*  Parameters: table, count (updated)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Sensor_Scan_thermal(struct sensor_watch_type *table, int *count)
+{
+	struct dirent **entry;
+	char path[96], type[32], label[48];
+	int i, n;
+
+	n = scandir(SENSOR_THERMAL, &entry, NULL, Sensor_Compare);
+	for (i=0; i<n; i++) {
+		if (strncmp(entry[i]->d_name, "thermal_zone", 12) == 0) {
+			snprintf(path, sizeof(path), SENSOR_THERMAL "/%.32s/type", entry[i]->d_name);
+			if (Sensor_Attribute(path, type, sizeof(type)) != 0)
+				snprintf(type, sizeof(type), "%.31s", entry[i]->d_name);
+			snprintf(label, sizeof(label), "thermal/%s", type);
+			snprintf(path, sizeof(path), SENSOR_THERMAL "/%.32s/temp", entry[i]->d_name);
+			Sensor_Add(table, count, label, SENSOR_TEMP, 0.001, path);
+		}
+		free(entry[i]);
+	}
+	if (n >= 0) free(entry);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Add the inputs of one hwmon chip: every <prefix><n>_input file, named
+*  by its <prefix><n>_label file if the driver has one.
+*
+*  Parameters: table, count (updated), dir (hwmonN), chip (label prefix)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Sensor_Scan_chip(struct sensor_watch_type *table, int *count, const char *dir, const char *chip)
+{
+	struct dirent **entry;
+	char path[96], channel[32], name[32], label[48];
+	const char *p;
+	int i, j, n, len;
+
+	snprintf(path, sizeof(path), SENSOR_HWMON "/%.32s", dir);
+	n = scandir(path, &entry, NULL, Sensor_Compare);
+	for (i=0; i<n; i++) {
+		p = strstr(entry[i]->d_name, "_input");
+		len = p ? p - entry[i]->d_name : 0;
+		for (j=0; p && p[6] == '\0' && len < 24 && j<sizeof(Sensor_input)/sizeof(Sensor_input[0]); j++) {
+			if (strncmp(entry[i]->d_name, Sensor_input[j].prefix, strlen(Sensor_input[j].prefix)) != 0) continue;
+			if (entry[i]->d_name[strlen(Sensor_input[j].prefix)] < '0' || entry[i]->d_name[strlen(Sensor_input[j].prefix)] > '9')
+				continue;				//e.g. "in" must not take "intrusion"
+			snprintf(channel, sizeof(channel), "%.*s", len, entry[i]->d_name);
+			snprintf(path, sizeof(path), SENSOR_HWMON "/%.32s/%s_label", dir, channel);
+			if (Sensor_Attribute(path, name, sizeof(name)) != 0)
+				strcpy(name, channel);
+			snprintf(label, sizeof(label), "%.15s/%.31s", chip, name);
+			snprintf(path, sizeof(path), SENSOR_HWMON "/%.32s/%.32s", dir, entry[i]->d_name);
+			Sensor_Add(table, count, label, Sensor_input[j].kind, Sensor_input[j].scale, path);
+			break;
+		}
+		free(entry[i]);
+	}
+	if (n >= 0) free(entry);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Scan the thermal zones and hwmon chips and replace the table. A chip
+*  name used before gets a number, e.g. pwmfan and pwmfan2. The chips of
+*  Sensor_skip_chip are not read at all.
+*
+*  Parameters: none
+*  Return: number of sensors
+*  Globals: Sensor_table, Sensor_count, Sensor_scanned
+****************************************************************************/
+static int Sensor_Scan()
+{
+	static struct sensor_watch_type table[SENSOR_MAX];
+	char names[32][16], path[96], chip[32], base[16];
+	struct dirent **entry;
+	int i, j, n, used, skip, chips = 0, count = 0;
+
+	Sensor_Scan_thermal(table, &count);
+	n = scandir(SENSOR_HWMON, &entry, NULL, Sensor_Compare);
+	for (i=0; i<n; i++) {
+		if (strncmp(entry[i]->d_name, "hwmon", 5) == 0) {
+			snprintf(path, sizeof(path), SENSOR_HWMON "/%.32s/name", entry[i]->d_name);
+			if (Sensor_Attribute(path, base, sizeof(base)) != 0)
+				snprintf(base, sizeof(base), "%.15s", entry[i]->d_name);
+			for (j=0, skip=0; j<sizeof(Sensor_skip_chip)/sizeof(Sensor_skip_chip[0]); j++)
+				if (strcmp(base, Sensor_skip_chip[j]) == 0) skip = 1;
+			if (skip) {
+				free(entry[i]);
+				continue;
+			}
+			for (j=0, used=1; j<chips; j++)
+				if (strcmp(names[j], base) == 0) used++;
+			if (chips < 32) strcpy(names[chips++], base);
+			if (used > 1)
+				snprintf(chip, sizeof(chip), "%s%d", base, used);
+			else
+				strcpy(chip, base);
+			Sensor_Scan_chip(table, &count, entry[i]->d_name, chip);
+		}
+		free(entry[i]);
+	}
+	if (n >= 0) free(entry);
+
+	for (i=0; i<Sensor_count; i++)
+		Source_Close(&Sensor_table[i].source);
+	for (i=0; i<count; i++) {
+		Sensor_table[i] = table[i];
+		Sensor_table[i].source.path = Sensor_table[i].path;	//point into the entry it is in
+		Sensor_table[i].source.buffer = Sensor_table[i].buffer;
+		Sensor_table[i].source.size = sizeof(Sensor_table[i].buffer);
+	}
+	Sensor_count = count;
+	Sensor_scanned = 1;
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read the uevents waiting on the socket.
+*
+*  Parameters: none
+*  Return: 1 if a hwmon or thermal device was added or removed
+*  Globals: Sensor_socket
+****************************************************************************/
+static int Sensor_Events()
+{
+	char buffer[4096];
+	const char *p, *action, *subsystem;
+	int len, changed = 0;
+
+	while ((len = recv(Sensor_socket, buffer, sizeof(buffer) - 1, MSG_DONTWAIT)) != 0) {
+		if (len < 0) {
+			if (errno == ENOBUFS) changed = 1;		//events lost
+			if (errno == EINTR || errno == ENOBUFS) continue;
+			break;
+		}
+		buffer[len] = '\0';
+		action = subsystem = NULL;
+		for (p = buffer; p < buffer + len; p += strlen(p) + 1) {
+			if (strncmp(p, "ACTION=", 7) == 0) action = p + 7;
+			else if (strncmp(p, "SUBSYSTEM=", 10) == 0) subsystem = p + 10;
+		}
+		if (action == NULL || subsystem == NULL) continue;
+		if (strcmp(subsystem, "hwmon") != 0 && strcmp(subsystem, "thermal") != 0) continue;
+		if (strcmp(action, "add") == 0 || strcmp(action, "remove") == 0) changed = 1;
+	}
+	return(changed);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Listen for uevents, find the sensors and read them once.
+*
+*  Parameters: none
+*  Return: error code, 1 if there are no sensors
+*  Globals: Sensor_socket
+****************************************************************************/
+int Sensor_Init()
+{
+	struct sockaddr_nl sa;
+
+	if (Sensor_socket < 0) {
+		Sensor_socket = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+		if (Sensor_socket >= 0) {
+			memset(&sa, 0, sizeof(sa));
+			sa.nl_family = AF_NETLINK;
+			sa.nl_groups = 1;				//kernel events
+			if (bind(Sensor_socket, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+				close(Sensor_socket);
+				Sensor_socket = -1;
+			}
+		}
+	}
+	Sensor_Scan();
+	Sensor_Sample();
+	return(Sensor_count ? 0 : 1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Read all sensors, after scanning again if sensors came or went.
+*
+*  Parameters: none
+*  Return: number of sensors that could not be read
+*  Globals: Sensor_table
+****************************************************************************/
+int Sensor_Sample()
+{
+	struct sensor_watch_type *watch;
+	struct sensor_type *s;
+	const char *p;
+	int i, failed = 0;
+
+	if (!Sensor_scanned || (Sensor_socket >= 0 && Sensor_Events()))
+		Sensor_Scan();
+
+	for (i=0; i<Sensor_count; i++) {
+		watch = &Sensor_table[i];
+		s = &watch->sensor;
+		if (Source_Read(&watch->source) < 0) {	//e.g. a drive asleep, or the device went
+			s->valid = 0;
+			failed++;
+			continue;
+		}
+		p = watch->buffer;
+		s->value = Source_Signed(&p) * watch->scale;
+		if (!watch->seen || s->value < s->min) s->min = s->value;
+		if (!watch->seen || s->value > s->max) s->max = s->value;
+		watch->seen = 1;
+		s->valid = 1;
+	}
+	return(failed);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the sensors from the last sample, thermal zones first.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of sensors copied
+*  Globals: none
+****************************************************************************/
+int Sensor_List(struct sensor_type *list, int max)
+{
+	int i, count = (Sensor_count < max) ? Sensor_count : max;
+
+	for (i=0; i<count; i++)
+		list[i] = Sensor_table[i].sensor;
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Find a sensor by label.
+*
+*  Parameters: label, sensor (result)
+*  Return: 0 if found and read by the last sample, 1 if not
+*  Globals: none
+****************************************************************************/
+int Sensor_Find(const char *label, struct sensor_type *sensor)
+{
+	int i;
+
+	for (i=0; i<Sensor_count; i++) {
+		if (strcmp(Sensor_table[i].sensor.label, label) != 0) continue;
+		*sensor = Sensor_table[i].sensor;
+		return(sensor->valid ? 0 : 1);
+	}
+	return(1);
+}
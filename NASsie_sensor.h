@@ -0,0 +1,31 @@
+/*************************************************************************
+* Header file for NASsie_sensor
+*
+* Thermal zones and hwmon sensors, kept open and addressed by label
+*
+*************************************************************************/
+
+#ifndef _NASSIE_SENSOR_H_
+#define _NASSIE_SENSOR_H_
+
+#define SENSOR_MAX 48
+
+enum sensor_kind_type {SENSOR_TEMP, SENSOR_FAN, SENSOR_VOLTAGE, SENSOR_CURRENT, SENSOR_POWER};
+
+/* One sensor. Labels are "thermal/<type>" for a thermal zone, e.g.
+   thermal/cpu-thermal, and "<chip>/<label>" for hwmon, e.g. cpu_thermal/temp1
+   or pwmfan/fan1 (the channel name if the chip has no label for it) */
+struct sensor_type {
+	char label[48];
+	enum sensor_kind_type kind;
+	double value;                   //Celcius, RPM, V, A or W
+	double min, max;                //since the sensor was found
+	int valid;                      //last read worked
+};
+
+int Sensor_Init();
+int Sensor_Sample();
+int Sensor_List(struct sensor_type *list, int max);
+int Sensor_Find(const char *label, struct sensor_type *sensor);
+
+#endif
@@ -0,0 +1,666 @@
+/*************************************************************************
+*                              NASsie_smart
+*                   Drive temperatures for NASsie
+*
+*   Reads drive temperatures and SMART attributes without hddtemp or
+* smartctl. ATA commands are sent with
+* SG_IO using the SCSI/ATA Translation (SAT) ATA PASS-THROUGH commands,
+* which also works through most USB-SATA bridges. The temperature is taken
+* from SMART attribute 194 or 190, then from the SCT Status log, and if the
+* drive does not answer pass-through from the kernel drivetemp driver.
+* The failure predicting attributes come from the same SMART data read.
+* NVMe drives have their SMART/Health log read instead, see NASsie_nvme.
+*   Each drive has its own probe thread, so a slow or hung drive only holds
+* up its own readings. The results are copied out without waiting.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <scsi/sg.h>
+#include "NASsie_smart.h"
+
+#define SAT_16          0x85    //ATA PASS-THROUGH(16)
+#define SAT_12          0xA1    //ATA PASS-THROUGH(12), for bridges without the 16 byte CDB
+#define SAT_NON_DATA    3       //protocols
+#define SAT_PIO_IN      4
+#define SG_TIMEOUT      1000    //milliseconds for one command, a probe is a few
+
+#define ATA_CHECK_POWER 0xE5
+#define ATA_SMART       0xB0
+#define SMART_READ_DATA 0xD0
+#define SMART_READ_LOG  0xD5
+#define SCT_STATUS_LOG  0xE0
+#define ATTR_REALLOCATED 5      //Reallocated_Sector_Ct
+#define ATTR_POWER_ON   9       //Power_On_Hours
+#define ATTR_AIRFLOW    190     //Airflow_Temperature_Cel
+#define ATTR_TEMP       194     //Temperature_Celsius
+#define ATTR_PENDING    197     //Current_Pending_Sector
+#define ATTR_UNCORRECTABLE 198  //Offline_Uncorrectable
+#define ATTR_CRC        199     //UDMA_CRC_Error_Count
+
+/* GLOBAL VARIBLES */
+struct smart_worker_type {
+	struct smart_drive_type state;
+	pthread_cond_t wake;
+	int pending;                    //probe requested
+	struct timespec started;
+	int running;                    //thread started
+	unsigned int generation;        //bumped by Smart_Set
+};
+static struct smart_worker_type Smart_worker[SMART_MAX_DRIVES];
+static int Smart_drives = 0;
+static pthread_mutex_t Smart_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/***************************************************************************
+*SUMMARY:
+*  Take the returned registers from the sense data. Descriptor format has
+*  an ATA Status Return descriptor (code 9), fixed format has them in the
+*  information and command specific fields.
+*
+*  Parameters: sense, len (valid bytes), tf (result)
+*  Return: 1 if registers were found
+*  Globals: none
+****************************************************************************/
+static int Smart_Sense_tf(const unsigned char *sense, int len, struct smart_ata_type *tf)
+{
+	const unsigned char *d;
+
+	if (len >= 8 && (sense[0] & 0x7f) == 0x72) {
+		for (d = sense + 8; d + 14 <= sense + len && d + 2 + d[1] <= sense + len; d += 2 + d[1]) {
+			if (d[0] != 0x09) continue;
+			tf->error = d[3];
+			tf->count = d[5];
+			tf->lba_low = d[7];
+			tf->lba_mid = d[9];
+			tf->lba_high = d[11];
+			tf->device = d[12];
+			tf->status = d[13];
+			return(1);
+		}
+	} else if (len >= 12 && (sense[0] & 0x7f) == 0x70) {
+		tf->error = sense[3];
+		tf->status = sense[4];
+		tf->device = sense[5];
+		tf->count = sense[6];
+		tf->lba_low = sense[9];
+		tf->lba_mid = sense[10];
+		tf->lba_high = sense[11];
+		return(1);
+	}
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Send one ATA PASS-THROUGH command. Tries the 16 byte CDB first and the
+*  12 byte one if the device (usually a USB bridge) refuses it.
+*
+*  Parameters: cdb_size (16 or 12), fd, tf, data, len
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+static int Smart_Sat(int cdb_size, int fd, struct smart_ata_type *tf, unsigned char *data, int len)
+{
+	unsigned char cdb[16], sense[32];
+	sg_io_hdr_t io;
+	int protocol, flags;
+
+	/* flags: ck_cond for non-data so the registers come back,
+	   t_dir in, byt_blok, length in the count field for data */
+	if (len > 0) {
+		protocol = SAT_PIO_IN;
+		flags = 0x0e;
+	} else {
+		protocol = SAT_NON_DATA;
+		flags = 0x20;
+	}
+
+	memset(cdb, 0, sizeof(cdb));
+	if (cdb_size == 16) {
+		cdb[0] = SAT_16;
+		cdb[1] = protocol << 1;
+		cdb[2] = flags;
+		cdb[4] = tf->feature;
+		cdb[6] = tf->count;
+		cdb[8] = tf->lba_low;
+		cdb[10] = tf->lba_mid;
+		cdb[12] = tf->lba_high;
+		cdb[13] = tf->device;
+		cdb[14] = tf->command;
+	} else {
+		cdb[0] = SAT_12;
+		cdb[1] = protocol << 1;
+		cdb[2] = flags;
+		cdb[3] = tf->feature;
+		cdb[4] = tf->count;
+		cdb[5] = tf->lba_low;
+		cdb[6] = tf->lba_mid;
+		cdb[7] = tf->lba_high;
+		cdb[8] = tf->device;
+		cdb[9] = tf->command;
+	}
+
+	memset(&io, 0, sizeof(io));
+	memset(sense, 0, sizeof(sense));
+	io.interface_id = 'S';
+	io.cmdp = cdb;
+	io.cmd_len = cdb_size;
+	io.sbp = sense;
+	io.mx_sb_len = sizeof(sense);
+	io.dxfer_direction = (len > 0) ? SG_DXFER_FROM_DEV : SG_DXFER_NONE;
+	io.dxferp = data;
+	io.dxfer_len = len;
+	io.timeout = SG_TIMEOUT;
+
+	if (ioctl(fd, SG_IO, &io) < 0) return(1);
+	if (io.host_status != 0 || (io.driver_status & 0x0f) > 1) return(1);	//1 is DRIVER_BUSY
+
+	tf->status = 0x50;			//DRDY, DSC: assume fine unless told otherwise
+	tf->error = 0;
+	if (io.sb_len_wr > 0) {
+		/* ck_cond gives "recovered error" with the registers, anything else
+		   without an ATA status is a real failure (illegal request etc.) */
+		if (!Smart_Sense_tf(sense, io.sb_len_wr, tf)) return(1);
+		if ((sense[0] & 0x7f) == 0x72 && (sense[1] & 0x0f) > 1) return(1);
+		if ((sense[0] & 0x7f) == 0x70 && (sense[2] & 0x0f) > 1) return(1);
+	} else if (io.status != 0 || len == 0)
+		return(1);		//some USB bridges drop the ck_cond registers, tf would still hold what was sent
+
+	return((tf->status & 0x01) ? 1 : 0);	//ERR bit
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Send an ATA command to a drive with SAT pass-through. Non-data commands
+*  (len 0) return the output registers in tf, a reply without them is an
+*  error.
+*
+*  Parameters: fd (open block or sg device), tf, data (512 byte sectors), len
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Smart_Ata(int fd, struct smart_ata_type *tf, unsigned char *data, int len)
+{
+	struct smart_ata_type copy = *tf;
+
+	if (Smart_Sat(16, fd, tf, data, len) == 0) return(0);
+	*tf = copy;
+	return(Smart_Sat(12, fd, tf, data, len));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Power state of a drive with ATA CHECK POWER MODE. The drive answers from
+*  its interface so this does not spin up a drive in standby. The state is
+*  returned in the count register.
+*
+*  Parameters: fd, power (result)
+*  Return: error code, power is SMART_POWER_UNKNOWN on error
+*  Globals: none
+****************************************************************************/
+int Smart_Power_mode(int fd, enum smart_power_type *power)
+{
+	struct smart_ata_type tf;
+
+	*power = SMART_POWER_UNKNOWN;
+	memset(&tf, 0, sizeof(tf));
+	tf.command = ATA_CHECK_POWER;
+	if (Smart_Ata(fd, &tf, NULL, 0) != 0) return(1);
+
+	switch (tf.count) {
+		case 0x00:				//standby
+		case 0x01:				//standby_y
+			*power = SMART_POWER_STANDBY;
+			break;
+		case 0x80 ... 0x83:			//idle, idle_a/b/c
+			*power = SMART_POWER_IDLE;
+			break;
+		default:				//0xff active or idle, NV cache modes
+			*power = SMART_POWER_ACTIVE;
+	}
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Raw value of a temperature attribute in SMART data. The lowest byte of
+*  the raw value is the current temperature.
+*
+*  Parameters: data (SMART READ DATA sector), id (attribute)
+*  Return: temperature in Celcius, -1 if the attribute is missing
+*  Globals: none
+****************************************************************************/
+static int Smart_Attribute(const unsigned char *data, int id)
+{
+	const unsigned char *a;
+	int i;
+
+	for (i=0; i<30; i++) {			//30 entries of 12 bytes from offset 2
+		a = data + 2 + 12*i;
+		if (a[0] == id && a[5] > 0 && a[5] < 128)
+			return(a[5]);
+	}
+	return(-1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Failure predicting attributes in SMART data, in one pass over the 30
+*  entries. Raw values are 6 bytes little endian from byte 5 of an entry,
+*  only the low 4 are used. Attributes the drive does not have are 0.
+*
+*  Parameters: data (SMART READ DATA sector), attributes (result)
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Smart_Parse_attributes(const unsigned char *data, struct smart_attributes_type *attributes)
+{
+	const unsigned char *a;
+	unsigned int raw;
+	int i;
+
+	memset(attributes, 0, sizeof(*attributes));
+	attributes->valid = 1;
+	for (i=0; i<30; i++) {
+		a = data + 2 + 12*i;
+		raw = a[5] | (a[6] << 8) | (a[7] << 16) | ((unsigned int)a[8] << 24);
+		switch (a[0]) {
+			case ATTR_REALLOCATED:
+				attributes->reallocated = raw;
+				break;
+			case ATTR_POWER_ON:
+				attributes->power_on_hours = raw;
+				break;
+			case ATTR_PENDING:
+				attributes->pending = raw;
+				break;
+			case ATTR_UNCORRECTABLE:
+				attributes->uncorrectable = raw;
+				break;
+			case ATTR_CRC:
+				attributes->crc_errors = raw;
+				break;
+		}
+	}
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Drive temperature from an open drive: SMART attributes 194 and 190, then
+*  the current temperature of the SCT Status log.
+*
+*  Parameters: fd, temperature (result in Celcius)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Smart_Temperature_fd(int fd, int *temperature)
+{
+	return(Smart_Data_fd(fd, temperature, NULL));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Drive temperature and SMART attributes from an open drive, with one
+*  SMART READ DATA. The SCT Status log is only read if the data has no
+*  temperature attribute.
+*
+*  Parameters: fd, temperature (result in Celcius), attributes (result,
+*              valid is 0 if the SMART data could not be read, may be NULL)
+*  Return: error code, 1 if there is no temperature
+*  Globals: none
+****************************************************************************/
+int Smart_Data_fd(int fd, int *temperature, struct smart_attributes_type *attributes)
+{
+	unsigned char data[512], sum;
+	struct smart_ata_type tf;
+	int i, t;
+
+	if (attributes != NULL) attributes->valid = 0;
+	memset(&tf, 0, sizeof(tf));
+	tf.command = ATA_SMART;
+	tf.feature = SMART_READ_DATA;
+	tf.count = 1;
+	tf.lba_mid = 0x4f;			//SMART signature
+	tf.lba_high = 0xc2;
+	if (Smart_Ata(fd, &tf, data, sizeof(data)) == 0) {
+		for (i=0, sum=0; i<512; i++) sum += data[i];	//checksum makes the sector add to 0
+		if (sum == 0 && attributes != NULL) Smart_Parse_attributes(data, attributes);
+		t = (sum == 0) ? Smart_Attribute(data, ATTR_TEMP) : -1;
+		if (t < 0 && sum == 0) t = Smart_Attribute(data, ATTR_AIRFLOW);
+		if (t > 0) {
+			*temperature = t;
+			return(0);
+		}
+	}
+
+	memset(&tf, 0, sizeof(tf));
+	tf.command = ATA_SMART;
+	tf.feature = SMART_READ_LOG;
+	tf.count = 1;
+	tf.lba_low = SCT_STATUS_LOG;
+	tf.lba_mid = 0x4f;
+	tf.lba_high = 0xc2;
+	if (Smart_Ata(fd, &tf, data, sizeof(data)) == 0 && (data[0] | data[1]) != 0
+	    && data[200] != 0x80 && (signed char)data[200] > 0) {
+		*temperature = (signed char)data[200];
+		return(0);
+	}
+	return(1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Drive temperature from the kernel drivetemp driver, which shows up as a
+*  hwmon device of the disk (/sys/block/sdX/device/hwmon/hwmonN).
+*
+*  Parameters: device (e.g. /dev/sda), temperature (result in Celcius)
+*  Return: error code, 1 if drivetemp is not loaded for the drive
+*  Globals: none
+****************************************************************************/
+int Smart_Temperature_hwmon(const char *device, int *temperature)
+{
+	char path[600];
+	const char *name = strrchr(device, '/');
+	struct dirent *entry;
+	DIR *dir;
+	FILE *fp;
+	int milli, found = 1;
+
+	name = (name != NULL) ? name + 1 : device;
+	snprintf(path, sizeof(path), "/sys/block/%s/device/hwmon", name);
+	dir = opendir(path);
+	if (dir == NULL) return(1);
+
+	while (found && (entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+		snprintf(path, sizeof(path), "/sys/block/%s/device/hwmon/%s/temp1_input", name, entry->d_name);
+		fp = fopen(path, "r");
+		if (fp == NULL) continue;
+		if (fscanf(fp, "%d", &milli) == 1) {
+			*temperature = milli / 1000;
+			found = 0;
+		}
+		fclose(fp);
+	}
+	closedir(dir);
+	return(found);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Drive temperature without waking the drive. The power state is checked
+*  first and a drive in standby is not asked for its temperature. If the
+*  state can not be read (no pass-through) the temperature is still read,
+*  drivetemp is then the only way to get it anyway. The SMART attributes
+*  come with the temperature, not from drivetemp.
+*
+*  Parameters: device (e.g. /dev/sda), temperature (result), power (result),
+*              attributes (result, valid is 0 if not read)
+*  Return: 0, SMART_ASLEEP (temperature not read) or 1 on error
+*  Globals: none
+****************************************************************************/
+int Smart_Read(const char *device, int *temperature, enum smart_power_type *power,
+               struct smart_attributes_type *attributes)
+{
+	int fd, error = 1;
+
+	*power = SMART_POWER_UNKNOWN;
+	attributes->valid = 0;
+	fd = open(device, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd >= 0) {
+		Smart_Power_mode(fd, power);
+		if (*power != SMART_POWER_STANDBY)
+			error = Smart_Data_fd(fd, temperature, attributes);
+		close(fd);
+	}
+	if (*power == SMART_POWER_STANDBY)
+		return(SMART_ASLEEP);
+	if (error)
+		error = Smart_Temperature_hwmon(device, temperature);
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Drive temperature, with pass-through first and drivetemp as fall back.
+*  This wakes a drive in standby, see Smart_Read.
+*
+*  Parameters: device (e.g. /dev/sda), temperature (result in Celcius)
+*  Return: error code
+*  Globals: none
+****************************************************************************/
+int Smart_Temperature(const char *device, int *temperature)
+{
+	int fd, error = 1;
+
+	fd = open(device, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd >= 0) {
+		error = Smart_Temperature_fd(fd, temperature);
+		close(fd);
+	}
+	if (error)
+		error = Smart_Temperature_hwmon(device, temperature);
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Tell an NVMe device from an ATA/SCSI one by its name.
+*
+*  Parameters: device (e.g. /dev/nvme0n1)
+*  Return: 1 if it is an NVMe device
+*  Globals: none
+****************************************************************************/
+int Smart_Nvme(const char *device)
+{
+	return(strncmp(device, "/dev/nvme", 9) == 0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Milliseconds since a time from CLOCK_MONOTONIC.
+*
+*  Parameters: since
+*  Return: milliseconds
+*  Globals: none
+****************************************************************************/
+static unsigned int Smart_Elapsed(const struct timespec *since)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Probe thread of one drive. Waits for a request, reads the drive with
+*  Smart_Read, or Nvme_Health for an NVMe drive, and stores the result and
+*  its statistics. The power state of an NVMe drive is left unknown, it
+*  goes to sleep and wakes up by itself. New SMART attributes are only
+*  stored, and attribute_changes bumped, when a value changed.
+*
+*  Parameters: arg (the drive's worker)
+*  Return: none, never ends
+*  Globals: none
+****************************************************************************/
+static void *Smart_Probe(void *arg)
+{
+	struct smart_worker_type *w = arg;
+	struct smart_drive_type *d = &w->state;
+	enum smart_power_type power;
+	struct nvme_health_type health;
+	struct smart_attributes_type attributes;
+	char device[sizeof(d->device)];
+	int temperature = 0, result, nvme;
+	unsigned int ms, generation;
+
+	pthread_mutex_lock(&Smart_lock);
+	while (1) {
+		while (!w->pending)
+			pthread_cond_wait(&w->wake, &Smart_lock);
+		w->pending = 0;
+		d->busy = 1;
+		clock_gettime(CLOCK_MONOTONIC, &w->started);
+		strcpy(device, d->device);		//Smart_Set may change it during the probe
+		generation = w->generation;
+		pthread_mutex_unlock(&Smart_lock);
+
+		nvme = Smart_Nvme(device);
+		if (nvme) {
+			power = SMART_POWER_UNKNOWN;
+			result = Nvme_Health(device, &health);
+			if (result == 0) temperature = health.temperature;
+		} else
+			result = Smart_Read(device, &temperature, &power, &attributes);
+		ms = Smart_Elapsed(&w->started);
+
+		pthread_mutex_lock(&Smart_lock);
+		d->busy = 0;
+		if (generation != w->generation) continue;	//drive replaced, result is of the old one
+		d->power = power;
+		if (result == 0) {
+			d->temperature = temperature;
+			d->stale = 0;
+			if (nvme) d->health = health;
+		} else {
+			d->stale = 1;
+			if (result != SMART_ASLEEP) d->errors++;
+		}
+		if (!nvme && attributes.valid && memcmp(&attributes, &d->attributes, sizeof(attributes)) != 0) {
+			d->attributes = attributes;
+			d->attribute_changes++;
+		}
+		d->last_ms = ms;
+		d->total_ms += ms;
+		if (ms > d->max_ms) d->max_ms = ms;
+		if (ms > SMART_DEADLINE) d->timeouts++;
+		d->results++;
+	}
+	return(NULL);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Give a drive slot a device, or take it away, for drives that are
+*  plugged in or removed. The statistics of the slot start again. The
+*  probe thread of the slot is started the first time it gets a device and
+*  then kept; a probe still running for the old device is thrown away.
+*
+*  Parameters: drive (slot, 0 to SMART_MAX_DRIVES-1), device (e.g. /dev/sde,
+*              NULL or "" to leave the slot empty)
+*  Return: error code
+*  Globals: Smart_worker[], Smart_drives
+****************************************************************************/
+int Smart_Set(int drive, const char *device)
+{
+	struct smart_worker_type *w;
+	pthread_t thread;
+	int error = 0;
+
+	if (drive < 0 || drive >= SMART_MAX_DRIVES) return(1);
+	w = &Smart_worker[drive];
+	pthread_mutex_lock(&Smart_lock);
+	if (!w->running) {
+		memset(w, 0, sizeof(*w));
+		pthread_cond_init(&w->wake, NULL);
+		if (pthread_create(&thread, NULL, Smart_Probe, w) != 0) error = 1;
+		else {
+			pthread_detach(thread);
+			w->running = 1;
+		}
+	}
+	if (!error) {
+		memset(&w->state, 0, sizeof(w->state));
+		snprintf(w->state.device, sizeof(w->state.device), "%s", device ? device : "");
+		w->state.nvme = Smart_Nvme(w->state.device);
+		w->state.stale = 1;
+		w->pending = 0;
+		w->generation++;
+		if (drive >= Smart_drives) Smart_drives = drive + 1;
+	}
+	pthread_mutex_unlock(&Smart_lock);
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Start a probe thread for each drive.
+*
+*  Parameters: device[] (e.g. /dev/sda), count
+*  Return: error code
+*  Globals: Smart_worker[], Smart_drives
+****************************************************************************/
+int Smart_Start(const char *device[], int count)
+{
+	int i;
+
+	if (Smart_drives > 0 || count > SMART_MAX_DRIVES) return(1);
+	for (i=0; i<count; i++)
+		if (Smart_Set(i, device[i]) != 0) return(1);
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Ask for a probe of a drive. Does not wait for it.
+*
+*  Parameters: drive (index given to Smart_Start)
+*  Return: 0 if requested, 1 if a probe is still running or waiting, or
+*          the slot has no device
+*  Globals: Smart_worker[]
+****************************************************************************/
+int Smart_Request(int drive)
+{
+	struct smart_worker_type *w;
+	int busy;
+
+	if (drive < 0 || drive >= Smart_drives) return(1);
+	w = &Smart_worker[drive];
+	pthread_mutex_lock(&Smart_lock);
+	busy = w->pending || w->state.busy || w->state.device[0] == '\0';
+	if (!busy) {
+		w->pending = 1;
+		pthread_cond_signal(&w->wake);
+	}
+	pthread_mutex_unlock(&Smart_lock);
+	return(busy);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Copy of the latest results. The lock is only held by the probe threads
+*  to store a result, never during a command, so this does not wait on a
+*  drive. A probe past its deadline shows its drive as stale.
+*
+*  Parameters: list (result), max (entries in list)
+*  Return: number of drives copied
+*  Globals: Smart_worker[]
+****************************************************************************/
+int Smart_Snapshot(struct smart_drive_type *list, int max)
+{
+	int i, count;
+
+	pthread_mutex_lock(&Smart_lock);
+	count = (Smart_drives < max) ? Smart_drives : max;
+	for (i=0; i<count; i++) {
+		list[i] = Smart_worker[i].state;
+		if (list[i].busy && Smart_Elapsed(&Smart_worker[i].started) > SMART_DEADLINE)
+			list[i].stale = 1;
+	}
+	pthread_mutex_unlock(&Smart_lock);
+	return(count);
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+* Header file for NASsie_smart
+*
+* Drive temperatures and SMART attributes read natively with SG_IO ATA
+* pass-through, and the health log of NVMe drives
+*
+*************************************************************************/
+
+#ifndef _NASSIE_SMART_H_
+#define _NASSIE_SMART_H_
+
+#include "NASsie_nvme.h"
+
+/* ATA taskfile of a pass-through command, also holds the registers returned */
+struct smart_ata_type {
+	unsigned char command;
+	unsigned char feature;
+	unsigned char count;
+	unsigned char lba_low, lba_mid, lba_high;
+	unsigned char device;
+	unsigned char status;           //returned
+	unsigned char error;            //returned
+};
+
+/* SMART attributes that predict a failure, and the power-on hours. Raw
+   values, low 32 bits: some vendors keep other counters in the upper bytes */
+struct smart_attributes_type {
+	int valid;                      //SMART data was read
+	unsigned int reallocated;       //5 Reallocated_Sector_Ct
+	unsigned int pending;           //197 Current_Pending_Sector
+	unsigned int uncorrectable;     //198 Offline_Uncorrectable
+	unsigned int crc_errors;        //199 UDMA_CRC_Error_Count, usually the cable
+	unsigned int power_on_hours;    //9 Power_On_Hours
+};
+
+/* Power state from ATA CHECK POWER MODE */
+enum smart_power_type {SMART_POWER_UNKNOWN, SMART_POWER_ACTIVE, SMART_POWER_IDLE, SMART_POWER_STANDBY};
+
+#define SMART_ASLEEP 2          //Smart_Read: drive in standby, left alone
+#define SMART_MAX_DRIVES 32     //a slot for every disk NASsie_block can list (BLOCK_MAX_DEVICES)
+#define SMART_DEADLINE   3000   //milliseconds a probe of one drive may take
+
+/* Result of the probes of one drive, see Smart_Snapshot */
+struct smart_drive_type {
+	char device[32];
+	int temperature;                //Celcius, last good reading
+	enum smart_power_type power;
+	int stale;                      //temperature is not from the last probe
+	int busy;                       //probe running
+	unsigned int results;           //probes finished, bumped for every result
+	unsigned int errors;            //probes without a temperature (not asleep)
+	unsigned int timeouts;          //probes over SMART_DEADLINE
+	unsigned int last_ms, max_ms;   //probe time
+	unsigned long long total_ms;
+	int nvme;                       //NVMe drive, health is valid after a good probe
+	struct nvme_health_type health;
+	struct smart_attributes_type attributes;    //ATA drives, last read
+	unsigned int attribute_changes; //bumped when the attributes change
+};
+
+int Smart_Ata(int fd, struct smart_ata_type *tf, unsigned char *data, int len);
+int Smart_Power_mode(int fd, enum smart_power_type *power);
+int Smart_Data_fd(int fd, int *temperature, struct smart_attributes_type *attributes);
+int Smart_Read(const char *device, int *temperature, enum smart_power_type *power,
+               struct smart_attributes_type *attributes);
+int Smart_Nvme(const char *device);
+int Smart_Temperature(const char *device, int *temperature);
+int Smart_Temperature_fd(int fd, int *temperature);
+int Smart_Temperature_hwmon(const char *device, int *temperature);
+int Smart_Start(const char *device[], int count);
+int Smart_Set(int drive, const char *device);
+int Smart_Request(int drive);
+int Smart_Snapshot(struct smart_drive_type *list, int max);
+
+#endif
@@ -0,0 +1,165 @@
+/*************************************************************************
+*                             NASsie_source
+*                      Metric files for NASsie
+*
+*   /proc and /sys files are opened once and read again from offset 0 with
+* pread into a buffer owned by the caller, one system call per sample. If a
+* read fails (the device behind a /sys file went away, hotplug) the file is
+* opened again on the next read.
+*   The scanners walk the buffer with a pointer and never allocate, they
+* replace strtok, atoi and atof.
+*
+*--------------------------------------------------------------------------
+* Copyright (c) 2024, Jeffrey Loeliger
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree.
+*************************************************************************/
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "NASsie_source.h"
+
+/***************************************************************************
+*SUMMARY:
+*  Read a metric file into its buffer. A failed read closes the file and
+*  it is opened again once straight away, so a file that was replaced
+*  (thermal zone or disk hotplugged) is picked up again. A file that does
+*  not fit is cut after its last whole line, so the scanners never see
+*  half a line, and truncated is set for the caller to report.
+*
+*  Parameters: src
+*  Return: bytes read, -1 on error (buffer is then empty)
+*  Globals: none
+****************************************************************************/
+int Source_Read(struct source_type *src)
+{
+	int tries, len = -1;
+
+	for (tries = 0; tries < 2 && len < 0; tries++) {
+		if (src->fd < 0) {
+			src->fd = open(src->path, O_RDONLY | O_CLOEXEC);
+			if (src->fd < 0) break;
+		}
+		do
+			len = pread(src->fd, src->buffer, src->size - 1, 0);
+		while (len < 0 && errno == EINTR);
+		if (len < 0)
+			Source_Close(src);
+	}
+	if (len < 0) len = 0;
+	src->truncated = (len == src->size - 1);
+	if (src->truncated)
+		while (len > 0 && src->buffer[len-1] != '\n') len--;
+	if (src->truncated && len == 0) len = src->size - 1;	//one line longer than the buffer
+	src->buffer[len] = '\0';
+	src->len = len;
+	return(len ? len : -1);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Close a metric file, the next read opens it again.
+*
+*  Parameters: src
+*  Return: none
+*  Globals: none
+****************************************************************************/
+void Source_Close(struct source_type *src)
+{
+	if (src->fd >= 0) close(src->fd);
+	src->fd = -1;
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Next unsigned number: skips anything up to the first digit (but not a
+*  new line), then reads the digits.
+*
+*  Parameters: p (position, moved past the number)
+*  Return: number, 0 if the line has no more numbers
+*  Globals: none
+****************************************************************************/
+unsigned long long Source_Unsigned(const char **p)
+{
+	const char *s = *p;
+	unsigned long long n = 0;
+
+	while (*s != '\0' && *s != '\n' && (*s < '0' || *s > '9')) s++;
+	while (*s >= '0' && *s <= '9')
+		n = n * 10 + (*s++ - '0');
+	*p = s;
+	return(n);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Next signed number, like Source_Unsigned with an optional '-'.
+*
+*  Parameters: p (position, moved past the number)
+*  Return: number
+*  Globals: none
+****************************************************************************/
+long long Source_Signed(const char **p)
+{
+	const char *s = *p;
+
+	while (*s != '\0' && *s != '\n' && *s != '-' && (*s < '0' || *s > '9')) s++;
+	if (*s == '-') {
+		*p = s + 1;
+		return(-(long long)Source_Unsigned(p));
+	}
+	*p = s;
+	return((long long)Source_Unsigned(p));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Next space separated word on the line, e.g. a device name in diskstats.
+*
+*  Parameters: p (position, moved past the word), len (result)
+*  Return: start of the word, len is 0 at the end of the line
+*  Globals: none
+****************************************************************************/
+const char *Source_Token(const char **p, int *len)
+{
+	const char *s = *p, *start;
+
+	while (*s == ' ' || *s == '\t') s++;
+	start = s;
+	while (*s != '\0' && *s != '\n' && *s != ' ' && *s != '\t') s++;
+	*len = s - start;
+	*p = s;
+	return(start);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Match a word at the start of p.
+*
+*  Parameters: p, word
+*  Return: position after the word, NULL if p does not start with it
+*  Globals: none
+****************************************************************************/
+const char *Source_Word(const char *p, const char *word)
+{
+	while (*word != '\0')
+		if (*p++ != *word++) return(NULL);
+	return(p);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Start of the next line.
+*
+*  Parameters: p
+*  Return: position after the next new line, or of the terminating 0
+*  Globals: none
+****************************************************************************/
+const char *Source_Line(const char *p)
+{
+	while (*p != '\0' && *p != '\n') p++;
+	return(*p == '\n' ? p + 1 : p);
+}
@@ -0,0 +1,33 @@
+/*************************************************************************
+* Header file for NASsie_source
+*
+* Metric files kept open and read again with pread, plus the scanners
+* used to parse them without allocating
+*
+*************************************************************************/
+
+#ifndef _NASSIE_SOURCE_H_
+#define _NASSIE_SOURCE_H_
+
+struct source_type {
+	const char *path;
+	int fd;                         //-1 until opened, or after an error
+	char *buffer;                   //filled by Source_Read, always 0 terminated
+	int size;
+	int len;
+	int truncated;                  //last read filled the buffer, the end of the file is missing
+};
+
+/* static char buf[4096]; static struct source_type src = SOURCE(path, buf); */
+#define SOURCE(path, buffer) {path, -1, buffer, sizeof(buffer), 0, 0}
+
+int Source_Read(struct source_type *src);
+void Source_Close(struct source_type *src);
+
+unsigned long long Source_Unsigned(const char **p);
+long long Source_Signed(const char **p);
+const char *Source_Token(const char **p, int *len);
+const char *Source_Word(const char *p, const char *word);
+const char *Source_Line(const char *p);
+
+#endif
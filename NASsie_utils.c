@@ -16,20 +16,68 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include "NASsie_net.h"
+#include "NASsie_fs.h"
+#include "NASsie_smart.h"
+#include "NASsie_cpu.h"
+#include "NASsie_mem.h"
+#include "NASsie_disk.h"
+#include "NASsie_block.h"
+#include "NASsie_dm.h"
+#include "NASsie_md.h"
+#include "NASsie_psi.h"
+#include "NASsie_freq.h"
+#include "NASsie_sensor.h"
+#include "NASsie_source.h"
+
+#if SMART_MAX_DRIVES < BLOCK_MAX_DEVICES
+#error "SMART_MAX_DRIVES must hold every drive Block_List can return"
+#endif
 
 #define BUFFER_SIZE 200
+#define SMART_BUSY_INTERVAL 15    //seconds between SMART reads of a drive in use
+#define SMART_IDLE_INTERVAL 600   //seconds between SMART reads of an idle drive
+#define SMART_AWAKE_TIME    60    //a drive that did I/O this recently is spinning
+#define SMART_ALERT_TIME    86400 //seconds a worse SMART attribute stays in the strip
+
+/* Sensor of the CPU temperature, the first label found is used */
+static const char *Cpu_sensor[] = {"thermal/cpu-thermal", "cpu_thermal/temp1"};
 
 /* GLOBAL VARIBLES */
-int Temp_CPU, Temp_dev_sd[4];
+int Temp_CPU, Temp_dev_sd[SMART_MAX_DRIVES];
+int Spin_dev_sd[SMART_MAX_DRIVES], Stale_dev_sd[SMART_MAX_DRIVES]; //power state, temperature not current
+char Drive_name[SMART_MAX_DRIVES][32]; //sda, "" for an empty slot
+int Wear_dev_sd[SMART_MAX_DRIVES]; //NVMe percent used, -1 for other drives
+unsigned long long Media_errors_dev_sd[SMART_MAX_DRIVES]; //NVMe media and data integrity errors
+char Smart_status[32]; //drive alert strip, "" if no SMART attribute got worse lately
+int Drive_count; //slots in use, some may be empty
 int Used_mem, Used_ssds, Used_hdds, Used_sdcard;
-int CPU_load[4], lastSum[4], lastIdle[4]; //one for each CPU core
+int Used_swap, Dirty_mem; //percent, MB not yet written
+struct disk_rate_type Io_dev[DISK_MAX_DEVICES]; //disks in use, see Update_Disk_io
+struct fs_volume_type Fs_dev[FS_MAX_VOLUMES]; //all volumes, fullest first
+int Fs_dev_count;
+int Io_dev_count;
+int CPU_load[4]; //first four cores
+int CPU_busy, CPU_iowait; //all cores, iowait smoothed
 char wlan_ip[BUFFER_SIZE], eth_ip[BUFFER_SIZE];
+int Rate_eth, Rate_wlan; //kB/s received and sent
+int Errors_eth, Errors_wlan; //errors and drops per second
+int Thin_used = -1; //percent of the fullest thin pool, data or metadata, -1 if none
+int Cache_hits = -1; //read hit percent of the worst cache since the last update, -1 if none
+char Md_status[32]; //RAID strip on the stats screen, "" when all arrays are healthy and idle
+int Md_alert; //0 healthy, 1 sync or check running, 2 an array is degraded or broken
+int Psi_cpu, Psi_mem, Psi_io; //percent of the last 10s some tasks were stalled
+int Freq_cur, Freq_max; //MHz of the fastest policy and its limit, 0 without cpufreq
+int Throttled = -1; //firmware throttle bits (FREQ_*), -1 if unknown
 char Size_mem[BUFFER_SIZE], Size_ssds[BUFFER_SIZE], Size_hdds[BUFFER_SIZE], Size_sdcard[BUFFER_SIZE]; //small strings
 
 /***************************************************************************
 *SUMMARY:
-*  Update global CPU temperature variable with CPU temperature in Celcius
-*  Read temperature in milli-degress from system file.
+*  Update global CPU temperature variable with CPU temperature in Celcius.
+*  All sensors of the registry are read in the same pass, see
+*  NASsie_sensor. Without a known CPU sensor the first thermal zone is used.
 *
 *  Parameters: none
 *  Return: error code, not currently used.
@@ -37,88 +85,237 @@ char Size_mem[BUFFER_SIZE], Size_ssds[BUFFER_SIZE], Size_hdds[BUFFER_SIZE], Size
 ****************************************************************************/
 int Update_Temp_CPU()
 {
-	char buffer[BUFFER_SIZE];
+	struct sensor_type list[SENSOR_MAX];
+	int i, count;
 
-	FILE *fp = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
+	Sensor_Sample();
+	for (i=0; i<sizeof(Cpu_sensor)/sizeof(Cpu_sensor[0]); i++) {
+		if (Sensor_Find(Cpu_sensor[i], &list[0]) == 0) {
+			Temp_CPU = (int)list[0].value;
+			return(0);
+		}
+	}
+	count = Sensor_List(list, SENSOR_MAX);
+	for (i=0; i<count; i++) {
+		if (strncmp(list[i].label, "thermal/", 8) == 0 && list[i].valid) {
+			Temp_CPU = (int)list[i].value;
+			return(0);
+		}
+	}
+	return(1);
+}
 
-	if (fp == NULL) return(1);
-	fgets(buffer, sizeof buffer, fp);
-	fclose(fp);       //close the file
+/***************************************************************************
+*SUMMARY:
+*  Number of I/Os completed or in flight for each of the given block
+*  devices, from the last diskstats sample. A change means the drive was
+*  used.
+*
+*  Parameters: name[] (e.g. "sda"), io[] (result, 0 if not found), count
+*  Return: none
+*  Globals: none
+****************************************************************************/
+static void Disk_Io(const char *name[], unsigned long long io[], int count)
+{
+	struct disk_stats_type stats;
+	int i;
 
-	Temp_CPU = (atoi(buffer)/1000);	//convert ascii milli-degrees to number */
-	return(0);
+	for (i=0; i<count; i++)
+		io[i] = (Disk_Counters(name[i], &stats) == 0) ? stats.reads + stats.writes + stats.in_flight : 0;
 }
 
 /***************************************************************************
 *SUMMARY:
 *  Update global drive temperature variables with drive temperature in Celcius.
-*  Function may be slow because it needs data from the drive itself.
+*  The temperature is read from the drive with SMART pass-through (or the
+*  drivetemp driver), for NVMe drives from their SMART/Health log which
+*  also has the wear and media errors. Drives in standby are not woken up,
+*  they and drives that do not answer keep their last value marked as stale.
+*  Cheap to call every second: /proc/diskstats decides which drives are read.
+*  A drive that did I/O in the last minute is already spinning so reading it
+*  costs nothing, it is read every SMART_BUSY_INTERVAL. An idle drive is
+*  only looked at every SMART_IDLE_INTERVAL.
+*  The reads run in the background, one thread per drive, this only asks
+*  for them and picks up the results so a hung drive never blocks the caller.
+*  The drives come from the block device registry: a drive that is plugged
+*  in gets a free slot, a removed drive frees its slot, the others keep
+*  theirs so their row on the screen does not move.
 *
 *  Parameters: none
-*  Return: error code, not currently used.
-*  Globals: Temp_dev_sd[0],Temp_dev_sd[1],Temp_dev_sd[2],Temp_dev_sd[3]
+*  Return: number of drives with a new result
+*  Globals: Temp_dev_sd[], Spin_dev_sd[], Stale_dev_sd[], Drive_name[], Drive_count,
+*           Wear_dev_sd[], Media_errors_dev_sd[]
 ****************************************************************************/
 int Update_Temp_SMART()
 {
-	char buffer[BUFFER_SIZE];
-	const char* command[4] = { "hddtemp -w /dev/sda", "hddtemp -w /dev/sdb",
-	                           "hddtemp -w /dev/sdc", "hddtemp -w /dev/sdd"
-	                         };
-	const char* device[4] = {"/dev/sda","/dev/sdb","/dev/sdc","/dev/sdd"};
-	char *temperature;
-	int i;
+	static unsigned int generation;
+	static int started = 0;
+	static unsigned long long last_io[SMART_MAX_DRIVES];
+	static time_t last_active[SMART_MAX_DRIVES], last_read[SMART_MAX_DRIVES];
+	static int read_once[SMART_MAX_DRIVES];
+	static unsigned int results[SMART_MAX_DRIVES];
+	struct smart_drive_type drive[SMART_MAX_DRIVES];
+	struct block_device_type list[BLOCK_MAX_DEVICES];
+	const char *name[SMART_MAX_DRIVES];
+	unsigned long long io[SMART_MAX_DRIVES];
+	char device[40];
+	struct timespec ts;
+	time_t now;
+	int i, j, n, interval, count = 0;
 
-	for (i=0; i<4; i++) {
-		if ( access( device[i],F_OK)==0) {   //does the drive exit
-			FILE *fp = popen(command[i], "r");
-			if (fp != NULL) {
-				fgets( buffer, BUFFER_SIZE, fp);
-				temperature = strtok(buffer, ":");
-				temperature = strtok(NULL, ":");
-				temperature = strtok(NULL, ":");
-				Temp_dev_sd[i] = atoi(temperature);
-			}
-			pclose(fp);
-//		printf("%s %i\n",command[i],Temp_dev_sd[i]);
-		} else
+	/* follow drives being plugged in and removed, a drive keeps its slot */
+	if (!started || Block_Generation() != generation) {
+		started = 1;
+		generation = Block_Generation();
+		n = Block_List(list, BLOCK_MAX_DEVICES);
+		for (i=0; i<SMART_MAX_DRIVES; i++) {
+			if (Drive_name[i][0] == '\0') continue;
+			for (j=0; j<n; j++)
+				if ((list[j].kind == BLOCK_SD || list[j].kind == BLOCK_NVME) &&
+				    strcmp(list[j].name, Drive_name[i]) == 0) break;
+			if (j < n) continue;
+			Smart_Set(i, NULL);			//removed
+			Drive_name[i][0] = '\0';
 			Temp_dev_sd[i] = 0;
-	};
-	return(0);
+			Stale_dev_sd[i] = 0;
+			Spin_dev_sd[i] = SMART_POWER_UNKNOWN;
+			Wear_dev_sd[i] = -1;
+			Media_errors_dev_sd[i] = 0;
+			count++;
+		}
+		for (j=0; j<n; j++) {
+			if (list[j].kind != BLOCK_SD && list[j].kind != BLOCK_NVME) continue;
+			for (i=0; i<SMART_MAX_DRIVES; i++)
+				if (strcmp(list[j].name, Drive_name[i]) == 0) break;
+			if (i < SMART_MAX_DRIVES) continue;
+			for (i=0; i<SMART_MAX_DRIVES && Drive_name[i][0] != '\0'; i++);
+			if (i == SMART_MAX_DRIVES) break;	//can not happen, see the #error above
+			snprintf(device, sizeof(device), "/dev/%.31s", list[j].name);
+			if (Smart_Set(i, device) != 0) continue;
+			strcpy(Drive_name[i], list[j].name);
+			Wear_dev_sd[i] = -1;
+			Media_errors_dev_sd[i] = 0;
+			read_once[i] = 0;
+			last_io[i] = 0;
+			results[i] = 0;
+			count++;
+		}
+		for (Drive_count = SMART_MAX_DRIVES; Drive_count > 0 && Drive_name[Drive_count-1][0] == '\0'; Drive_count--);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = ts.tv_sec;
+	for (i=0; i<Drive_count; i++) name[i] = Drive_name[i];
+	Disk_Io(name, io, Drive_count);
+	Smart_Snapshot(drive, Drive_count);
+
+	for (i=0; i<Drive_count; i++) {
+		if (Drive_name[i][0] == '\0') continue;
+		if (io[i] != last_io[i]) last_active[i] = now;
+		last_io[i] = io[i];
+		interval = (now - last_active[i] < SMART_AWAKE_TIME) ? SMART_BUSY_INTERVAL : SMART_IDLE_INTERVAL;
+		if ((!read_once[i] || now - last_read[i] >= interval) && Smart_Request(i) == 0) {
+			read_once[i] = 1;
+			last_read[i] = now;
+		}
+
+		if (drive[i].results != results[i] || drive[i].stale != Stale_dev_sd[i]) {
+			results[i] = drive[i].results;
+			Temp_dev_sd[i] = drive[i].temperature;
+			Stale_dev_sd[i] = drive[i].stale;
+			Spin_dev_sd[i] = drive[i].power;
+			if (drive[i].nvme && !drive[i].stale) {
+				Wear_dev_sd[i] = drive[i].health.percent_used;
+				Media_errors_dev_sd[i] = drive[i].health.media_errors;
+			}
+			count++;
+		}
+	}
+	return(count);
+}
+
+/***************************************************************************
+*SUMMARY: Look for drives getting worse. The probe threads only publish
+*  new SMART attributes when a value changed, see Smart_Probe, so this only
+*  compares drives with a change. An increase of a failure predicting
+*  attribute is shown in the strip for SMART_ALERT_TIME. The first reading
+*  of a drive is taken as it is.
+*
+*  Parameters: none
+*  Return: number of drives with an attribute that went up since the last call
+*  Globals: Smart_status
+****************************************************************************/
+int Update_Smart()
+{
+	static struct smart_attributes_type last[SMART_MAX_DRIVES];
+	static unsigned int changes[SMART_MAX_DRIVES];
+	static char device[SMART_MAX_DRIVES][32];
+	static time_t alert_time;
+	struct smart_drive_type drive[SMART_MAX_DRIVES];
+	struct smart_attributes_type *a, *l;
+	struct timespec ts;
+	const char *name;
+	int i, count, worse = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	count = Smart_Snapshot(drive, SMART_MAX_DRIVES);
+	for (i=0; i<count; i++) {
+		if (strcmp(device[i], drive[i].device) != 0) {	//another drive in the slot
+			strcpy(device[i], drive[i].device);
+			last[i].valid = 0;
+			changes[i] = 0;
+		}
+		if (drive[i].attribute_changes == changes[i]) continue;
+		changes[i] = drive[i].attribute_changes;
+		a = &drive[i].attributes;
+		l = &last[i];
+		name = strrchr(device[i], '/');
+		name = (name != NULL) ? name + 1 : device[i];
+		if (l->valid && (a->reallocated > l->reallocated || a->pending > l->pending ||
+		                 a->uncorrectable > l->uncorrectable || a->crc_errors > l->crc_errors)) {
+			if (a->reallocated > l->reallocated)
+				snprintf(Smart_status, sizeof(Smart_status), "%.10s realloc +%u", name, a->reallocated - l->reallocated);
+			else if (a->pending > l->pending)
+				snprintf(Smart_status, sizeof(Smart_status), "%.10s pending +%u", name, a->pending - l->pending);
+			else if (a->uncorrectable > l->uncorrectable)
+				snprintf(Smart_status, sizeof(Smart_status), "%.10s uncorr +%u", name, a->uncorrectable - l->uncorrectable);
+			else
+				snprintf(Smart_status, sizeof(Smart_status), "%.10s CRC err +%u", name, a->crc_errors - l->crc_errors);
+			alert_time = ts.tv_sec;
+			worse++;
+		}
+		*l = *a;
+	}
+	if (Smart_status[0] != '\0' && ts.tv_sec - alert_time > SMART_ALERT_TIME)
+		Smart_status[0] = '\0';
+	return(worse);
 }
 
 /***************************************************************************
-*SUMMARY: Update global memory used by CPU and return as percentage.
+*SUMMARY: Update global memory used by CPU and return as percentage, with
+*  the swap in use and the data waiting to be written to disk. Dirty and
+*  writeback growing while the disks are busy is a write stall.
 *
 *  Parameters: none
 *  Return: error code, not currently used.
-*  Globals: Used_mem
+*  Globals: Used_mem, Used_swap, Dirty_mem
 ****************************************************************************/
 int Update_Used_mem()
 {
-	char buffer[BUFFER_SIZE];
-	char *size;
-	double t, a;
-
-	FILE *fp = fopen("/proc/meminfo", "r");
-	if (fp == NULL) return(1);
-
-	fgets(buffer, sizeof buffer, fp); //total memory
-
-	/* Determine percentage used */
-	fgets(buffer, sizeof buffer, fp);  //ignore free value
-	fgets(buffer, sizeof buffer, fp);  //available memory
-	fclose(fp);
-	size = strtok(buffer, ":");
-	size = strtok(NULL, ":");
-	a = atof(size);
-	t = atof(Size_mem);
-	Used_mem = (lround((1.0-(a/t))* 100.0));
+	struct mem_info_type info;
+
+	if (Mem_Read(&info) != 0) return(1);
+	Used_mem = Mem_Used(&info);
+	Used_swap = Mem_Swap_used(&info);
+	Dirty_mem = (info.dirty + info.writeback) / 1024;	//MB
 	return(0);
 }
 
 /***************************************************************************
 *SUMMARY:
-*  Update global variable network addresses for both interfaces.
+*  Update global variable network addresses for both interfaces from the
+*  address table kept by NASsie_net. Cheap enough to call every second, it
+*  only copies the strings when the table changed.
 *
 *  Parameters: none
 *  Return: error code, not currently used.
@@ -126,145 +323,329 @@ int Update_Used_mem()
 ****************************************************************************/
 int Update_Network()
 {
-	char buffer[BUFFER_SIZE];
-	char *tok;
-	FILE *fp;
-
-	/* wlan0 */
-	fp = popen("ifconfig wlan0", "r");
-	fgets( buffer, sizeof buffer, fp);
-	fgets( buffer, sizeof buffer, fp);
-	pclose(fp);
-
-	tok = strtok(buffer, " ");
-	if (strcmp(tok, "inet") == 0) {
-		tok = strtok(NULL, " ");
-		strcpy(wlan_ip, tok);
-	} else {
+	static unsigned int generation = 0;
+	static int first = 1;
+	unsigned int now = Net_Generation();
+
+	if (!first && now == generation) return(0);
+	first = 0;
+	generation = now;
+
+	if (Net_Address("wlan0", AF_INET, wlan_ip, BUFFER_SIZE) != 0)
 		wlan_ip[0] = '\0';
+	if (Net_Address("eth0", AF_INET, eth_ip, BUFFER_SIZE) != 0)
+		eth_ip[0] = '\0';
+
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY: Update the traffic of the wired and wireless interfaces, received
+*  and sent together, and their errors and drops.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Rate_eth, Rate_wlan, Errors_eth, Errors_wlan
+****************************************************************************/
+int Update_Network_io()
+{
+	struct net_link_type link;
+
+	if (Net_Link_sample() != 0) return(1);
+	if (Net_Link("eth0", &link) == 0) {
+		Rate_eth = lround((link.rx_bytes_s + link.tx_bytes_s) / 1000.0);
+		Errors_eth = lround(link.errors_s);
+	} else
+		Rate_eth = Errors_eth = 0;
+	if (Net_Link("wlan0", &link) == 0) {
+		Rate_wlan = lround((link.rx_bytes_s + link.tx_bytes_s) / 1000.0);
+		Errors_wlan = lround(link.errors_s);
+	} else
+		Rate_wlan = Errors_wlan = 0;
+	return(0);
+}
+
+/***************************************************************************
+*SUMMARY: Update the LVM thin pool and cache figures from device mapper.
+*  A pool that runs out of data or metadata space stops all its volumes,
+*  so the fuller of the two is kept. A cache without reads since the last
+*  update does not count.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Thin_used, Cache_hits
+****************************************************************************/
+int Update_Dm()
+{
+	struct dm_volume_type list[DM_MAX_VOLUMES];
+	double used = -1.0, hits = -1.0;
+	int i, count;
+
+	if (Dm_Sample() != 0) return(1);
+	count = Dm_Volumes(list, DM_MAX_VOLUMES);
+	for (i=0; i<count; i++) {
+		if (list[i].kind == DM_KIND_THIN_POOL) {
+			if (list[i].data_percent > used) used = list[i].data_percent;
+			if (list[i].meta_percent > used) used = list[i].meta_percent;
+		}
+		if (list[i].kind == DM_KIND_CACHE && list[i].read_hit_recent >= 0.0)
+			if (hits < 0.0 || list[i].read_hit_recent < hits) hits = list[i].read_hit_recent;
 	}
+	Thin_used = (used < 0.0) ? -1 : (int)ceil(used);
+	Cache_hits = (hits < 0.0) ? -1 : (int)floor(hits);
+	return(0);
+}
 
-	/* eth0 */
-	fp = popen("ifconfig eth0", "r");
-	fgets( buffer, sizeof buffer, fp);
-	fgets( buffer, sizeof buffer, fp);
-	pclose(fp);
-
-	tok = strtok(buffer, " ");
-	if (strcmp(tok, "inet") == 0) {
-		tok = strtok(NULL, " ");
-		strcpy(eth_ip, tok);
-	} else {
-		eth_ip[0] = '\0';
+/***************************************************************************
+*SUMMARY: Update the stall times of the CPU, memory and I/O.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Psi_cpu, Psi_mem, Psi_io
+****************************************************************************/
+int Update_Psi()
+{
+	struct psi_type psi;
+	int error;
+
+	error = Psi_Sample();
+	Psi_Read(PSI_CPU, &psi);
+	Psi_cpu = lround(psi.some_avg10);
+	Psi_Read(PSI_MEMORY, &psi);
+	Psi_mem = lround(psi.some_avg10);
+	Psi_Read(PSI_IO, &psi);
+	Psi_io = lround(psi.some_avg10);
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY: Update the CPU frequency and the firmware throttle state. With
+*  more than one policy (big.LITTLE) the fastest core is shown.
+*
+*  Parameters: none
+*  Return: error code
+*  Globals: Freq_cur, Freq_max, Throttled
+****************************************************************************/
+int Update_Freq()
+{
+	struct freq_policy_type list[FREQ_MAX_POLICIES];
+	unsigned int bits;
+	int i, count, error;
+
+	error = Freq_Sample();
+	count = Freq_Policies(list, FREQ_MAX_POLICIES);
+	Freq_cur = Freq_max = 0;
+	for (i=0; i<count; i++) {
+		if (list[i].cur / 1000 > Freq_cur) Freq_cur = list[i].cur / 1000;
+		if (list[i].max / 1000 > Freq_max) Freq_max = list[i].max / 1000;
 	}
+	Throttled = (Freq_Throttled(&bits) == 0) ? (int)bits : -1;
+	return(error);
+}
 
-	return(0);
+/***************************************************************************
+*SUMMARY: Check if an array is missing a device or stopped working.
+*
+*  Parameters: array
+*  Return: 1 if failed
+*  Globals: none
+****************************************************************************/
+static int Array_Failed(const struct md_array_type *array)
+{
+	return(array->degraded > 0 || strcmp(array->state, "broken") == 0 || strcmp(array->state, "inactive") == 0);
+}
+
+/***************************************************************************
+*SUMMARY: Update the software RAID strip. A degraded or broken array is
+*  shown before a sync, a recovery onto a spare shows its progress in the
+*  colour of a degraded array. The time left is from the current speed.
+*
+*  Parameters: none
+*  Return: number of arrays that lost a device or broke since the last call
+*  Globals: Md_status, Md_alert
+****************************************************************************/
+int Update_Md()
+{
+	static struct md_array_type last[MD_MAX_ARRAYS];
+	static int last_count = 0;
+	struct md_array_type list[MD_MAX_ARRAYS], *a;
+	char eta[16] = "";
+	int i, j, count, failed, worse = 0, shown = -1, alert = 0;
+
+	Md_Sample();
+	count = Md_Arrays(list, MD_MAX_ARRAYS);
+	for (i=0; i<count; i++) {
+		a = &list[i];
+		failed = Array_Failed(a);
+		for (j=0; j<last_count; j++) {
+			if (strcmp(last[j].name, a->name) != 0) continue;
+			if (a->degraded > last[j].degraded || (failed && !Array_Failed(&last[j])))
+				worse++;
+			break;
+		}
+		if (failed && alert < 2) {
+			alert = 2;
+			shown = i;
+		} else if (a->percent >= 0.0 && alert < 1) {
+			alert = 1;
+			shown = i;
+		}
+	}
+	memcpy(last, list, count * sizeof(list[0]));
+	last_count = count;
+
+	Md_alert = alert;
+	if (shown < 0) {
+		Md_status[0] = '\0';
+		return(worse);
+	}
+	a = &list[shown];
+	if (a->eta >= 360000)
+		eta[0] = '\0';
+	else if (a->eta >= 3600)
+		snprintf(eta, sizeof(eta), " %dh%02dm", a->eta / 3600, a->eta / 60 % 60);
+	else if (a->eta >= 0)
+		snprintf(eta, sizeof(eta), " %dm", (a->eta + 59) / 60);
+	if (a->percent >= 0.0)
+		snprintf(Md_status, sizeof(Md_status), "%.7s %.7s %d%%%s", a->name, a->action, (int)a->percent, eta);
+	else if (a->degraded > 0)
+		snprintf(Md_status, sizeof(Md_status), "%.7s missing %d of %d", a->name, a->degraded, a->raid_disks);
+	else
+		snprintf(Md_status, sizeof(Md_status), "%.7s %.10s", a->name, a->state);
+	return(worse);
+}
+
+/***************************************************************************
+*SUMMARY: Update the I/O rates of the disks, volumes and SD card. Sampled
+*  every second, the drive temperature scheduling uses the same sample.
+*
+*  Parameters: none
+*  Return: error code, DISK_TRUNCATED if some devices may be missing
+*  Globals: Io_dev[], Io_dev_count
+****************************************************************************/
+int Update_Disk_io()
+{
+	int error;
+
+	error = Disk_Sample();
+	if (error != 0 && error != DISK_TRUNCATED) return(1);
+	Io_dev_count = Disk_Rates(Io_dev, DISK_MAX_DEVICES);
+	return(error);
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Sort volumes fullest first, by name if they are as full.
+*
+*  Parameters: a, b (volumes)
+*  Return: order
+*  Globals: none
+****************************************************************************/
+static int Volume_Fuller(const void *a, const void *b)
+{
+	const struct fs_volume_type *va = a, *vb = b;
+
+	if (va->usage.percent != vb->usage.percent) return(vb->usage.percent - va->usage.percent);
+	return(strcmp(va->name, vb->name));
+}
+
+/***************************************************************************
+*SUMMARY:
+*  Percentage used of a volume from the last sweep, by file system or by
+*  mount point.
+*
+*  Parameters: dev (0 to look up by mount), mount
+*  Return: percent, -1 if the volume is not in the sweep
+*  Globals: Fs_dev[], Fs_dev_count
+****************************************************************************/
+static int Volume_Used(dev_t dev, const char *mount)
+{
+	int i;
+
+	for (i=0; i<Fs_dev_count; i++)
+		if ((dev != 0 && Fs_dev[i].dev == dev) || (dev == 0 && strcmp(Fs_dev[i].mount, mount) == 0))
+			return(Fs_dev[i].usage.percent);
+	return(-1);
 }
 
 /***************************************************************************
 *SUMMARY:
-*  Update amount of file system used by device in percentage.
+*  Update amount of file system used by device in percentage, the same
+*  number df shows. All volumes in the mount table are read in one sweep,
+*  one statvfs each, see Fs_Volumes; the three bars of the stats screen
+*  take their numbers from it. The volumes of the bars are picked from the
+*  block devices again only when a device was added or removed.
 *
 *  Parameters: none
 *  Return: error code, not currently used.
-*  Globals: wlan_ip, eth_ip
+*  Globals: Used_hdds, Used_sdcard, Used_ssds, Fs_dev[], Fs_dev_count
 ****************************************************************************/
 int Update_Used_fs()
 {
-	static char buffer[BUFFER_SIZE];
-	FILE *fp;
-
-	if (access("/dev/dm-0",F_OK) == 0) {
-		fp = popen("df --output=pcent /dev/dm-0", "r");
-		if (fp == NULL) return(1);
-		fgets( buffer, sizeof buffer, fp);
-		fgets( buffer, sizeof buffer, fp);
-		fclose(fp);
-		Used_hdds = (atoi(buffer));
-	} else Used_hdds = -1;
-
-	fp = popen("df --output=pcent /", "r");
-	if (fp == NULL) return(1);
-	fgets( buffer, sizeof buffer, fp);
-	fgets( buffer, sizeof buffer, fp);
-	fclose(fp);
-	Used_sdcard = (atoi(buffer));
-
-	if (access("/dev/dm-1",F_OK) == 0) {
-		fp = popen("df --output=pcent /dev/dm-1", "r");
-		if (fp == NULL) return(1);
-		fgets( buffer, sizeof buffer, fp);
-		fgets( buffer, sizeof buffer, fp);
-		fclose(fp);
-		Used_ssds = (atoi(buffer));
-	} else Used_ssds = -1;
+	static unsigned int generation;
+	static int started = 0;
+	static char hdds[40], ssds[40];
+	struct block_device_type list[BLOCK_MAX_DEVICES];
+	struct fs_usage_type usage;
+	struct fs_mount_type mount;
+	int i, n;
+
+	Fs_dev_count = Fs_Volumes(Fs_dev, FS_MAX_VOLUMES);
+	qsort(Fs_dev, Fs_dev_count, sizeof(Fs_dev[0]), Volume_Fuller);
+
+	/* the HDD volume is the first on spinning disks, the SSD volume the first that is not */
+	if (!started || Block_Generation() != generation) {
+		started = 1;
+		generation = Block_Generation();
+		hdds[0] = ssds[0] = '\0';
+		n = Block_List(list, BLOCK_MAX_DEVICES);
+		for (i=0; i<n; i++) {
+			if (list[i].kind != BLOCK_DM && list[i].kind != BLOCK_MD) continue;
+			if (list[i].rotational && hdds[0] == '\0')
+				snprintf(hdds, sizeof(hdds), "/dev/%.31s", list[i].name);
+			else if (!list[i].rotational && ssds[0] == '\0')
+				snprintf(ssds, sizeof(ssds), "/dev/%.31s", list[i].name);
+		}
+	}
+
+	if (hdds[0] != '\0' && Fs_Find_dev(hdds, &mount) == 0)
+		Used_hdds = Volume_Used(mount.dev, mount.mount);
+	else Used_hdds = -1;
+
+	Used_sdcard = Volume_Used(0, "/");
+	if (Used_sdcard < 0 && Fs_Usage("/", &usage) == 0)	//root on overlayfs and the like
+		Used_sdcard = usage.percent;
+
+	if (ssds[0] != '\0' && Fs_Find_dev(ssds, &mount) == 0)
+		Used_ssds = Volume_Used(mount.dev, mount.mount);
+	else Used_ssds = -1;
 
 	return(0);
 }
 
 /***************************************************************************
 *SUMMARY:
-* Determine the percentage busy for all CPUs:
-*  1. read /proc/stat
-*  2. select line for CPU (total, CPU0, CPU1, CPU2, CPU3)
-*  3. discard the first word of that first line   (it's always cpu)
-*  4. sum all of the times found on that first line to get the total time
-*  5. divide the fourth column ("idle") by the total time, to get the fraction of time spent being idle
-*  6. subtract the previous fraction from 1.0 to get the time spent being   not   idle
-*  7. multiple by   100   to get a percentage
-*  8. subtract from 100 to get busy percentage
+*  Update the load of the first four cores (one bar each on the stats
+*  screen) and of all cores together. Busy does not include iowait, that
+*  is kept apart so waiting on the disks does not look like work.
 *
 *  Parameters: none
 *  Return: error code, not currently used.
-*  Globals: ...
+*  Globals: CPU_load[], CPU_busy, CPU_iowait
 ****************************************************************************/
-
 int Update_Load_CPU()
 {
-	char buffer[BUFFER_SIZE];
-	char* token;
-	const char d[2] = " ";     //string delimiter characters
-	int i,j;
-	FILE* fp;
-	long int sum = 0, idle, a, b;
-	double idleFraction, x, y, z;
-
-//Load buffer with the line for the requested CPU
-	fp = fopen("/proc/stat","r");
-	fgets(buffer, sizeof buffer, fp); //read & ignore all CPUs combined
-	for (i = 0; i < (4); i++) {
-		fgets(buffer, sizeof buffer, fp);
-//		    printf("CPU %i : %s\n",i,buffer);  //DEBUG
-		token = strtok(buffer,d);    //ignore CPUx characters
-		j=0;
-		sum = 0;
-		while(token!=NULL) {
-			token = strtok(NULL,d);
-			if(token!=NULL) {
-				sum += atoi(token);
-				if(j==3)
-					idle = atoi(token);
-				j++;
-			}
-		}
-		//	printf("idle: %ld  lastidle: %ld  sum: %ld lastsum: %ld\n", idle, lastIdle, sum, lastSum);
-
-		a = (idle)-lastIdle[i];
-		b = (sum)-lastSum[i];
-		x = a;
-		y = b;
-		z = (x / y) * 100.0;
-
-//		printf("CPU %i a: %i   b: %i  z: %f\n",i, a, b, z);
-		idleFraction = 100.0 - z;
-//		printf("CPU %i Busy: %f %%, a: %i b: %i.\n",i, idleFraction,a,b);
+	struct cpu_load_type load;
+	int i;
 
-		lastIdle[i] = idle;
-		lastSum[i] = sum;
-		CPU_load[i]= idleFraction;
-	}
-	fclose(fp);
+	if (Cpu_Count() == 0 && Cpu_Init() != 0) return(1);
+	if (Cpu_Sample() != 0) return(1);
 
+	for (i=0; i<4; i++)
+		CPU_load[i] = (Cpu_Load(i, &load) == 0 && load.online) ? lround(load.busy) : 0;
+	Cpu_Load(CPU_TOTAL, &load);
+	CPU_busy = lround(load.busy);
+	CPU_iowait = lround(load.iowait_avg);
 	return(0);
 }
 
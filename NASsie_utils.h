@@ -10,9 +10,16 @@
 
 int Update_Temp_CPU();
 int Update_Temp_SMART();
+int Update_Smart();
 int Update_Used_mem();
 int Update_Used_fs();
 int Update_Network();
+int Update_Network_io();
 int Update_Load_CPU();
+int Update_Disk_io();
+int Update_Dm();
+int Update_Md();
+int Update_Psi();
+int Update_Freq();
  
 #endif
\ No newline at end of file